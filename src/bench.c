@@ -0,0 +1,737 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Needed for clock_gettime() and getrusage() when compiling in strict C11 mode.
+#define _DEFAULT_SOURCE
+
+#include "nib.h"
+
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NIB_BENCH_POSIX
+#include <unistd.h>
+#include <sys/resource.h>
+#elif defined(_WIN32)
+#define NIB_BENCH_WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#define REPETITIONS 5u
+#define ECHO_INPUT_SIZE (16u * 1024u * 1024u)
+#define LOAD_SIZE (16u * 1024u * 1024u)
+
+/**
+ * Represents a benchmarked script.
+ *
+ * The scripts are written as BF, and are encoded to nibbles before being benchmarked. They are fixed, and so is
+ * their input, so every benchmark runs exactly the same operations.
+ */
+struct Workload {
+    const char* name;
+    const char* source;
+    // The amount of times that the script is run for each measurement, so that short scripts can be measured.
+    uint32_t runs;
+    // Whether or not the script reads the echo input.
+    bool readsInput;
+    // Whether or not the script counts down from 0, which takes far longer with values wider than 8 bits.
+    bool wraps;
+};
+
+// Prints the squares from 0 to 10000, which is mostly arithmetic on decimal digits (by Daniel B. Cristofani).
+#define SQUARES_SOURCE \
+    "++++[>+++++<-]>[<+++++>-]+<+[>[>+>+<<-]++>>[<<+>>-]>>>[-]++>[-]+>>>+[[-]++++++>>>]<<<[[<++++++++<++>>-]+<.<[>" \
+    "----<-]<]<<[>>>>>[>>>[-]+++++++++<[>-<-]+++++++++>[-[<->-]+[<<<]]<[>+<-]>]<<-]<<-]"
+
+// Prints the alphabet on 65025 lines, which writes about 1.7 MB.
+#define PRINTER_SOURCE \
+    ">>>++++++++[<++++++++>-]<+>++++++++++++++++++++++++++>++++++++++<<<<-[>-[>>[<.+>-]<----------------------" \
+    "---->++++++++++++++++++++++++++>.<<<-]<-]"
+
+// Runs 5 nested loops, where the innermost one can't be replaced with faster operations.
+#define NESTED_SOURCE "++++++++[>++++++++[>++++++++[>++++++++[>++++++++[>--[-->+<]<-]<-]<-]<-]<-]"
+
+// Carries two counters across about 1 million values, leaving a value of 1 behind every 16 values.
+#define SWEEP_SOURCE \
+    "->-<[>[-<>[->>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<<<]<[->>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>><+>>]-<-]"
+
+// Draws the Mandelbrot set as 64x24 ASCII art, with values of 4 fractional bits that wrap around at 8 bits.
+#define MANDELBROT_SOURCE \
+    "++++++++++++++++++++++++>>>>>>>>>+++++++++++++++++++++++<<<<<<<<<[>>>>>>[-]-------------------------------" \
+    "---------<<<++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++[>>>>>>>>>>>>>>>>>>>>>>>>+<<<<" \
+    "<<++++++++++++++++++++++++>>>>>>[<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>>>>>>>+<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[<<<+>>>[-]]<<<[<<<<<<->>>+<<<<<<<<<<<<<<<+>>>>>>>>>>>>>" \
+    "+<[>-]>[->>>>>-<<<<]>>+<[>-]>[->>-<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>]>]<<<<<<[-]>>>[-]<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>>>>>>" \
+    ">>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<[>>>+<<<[-]]>>>[>>>>>>-<<<+<<<<<<<" \
+    "<<<<<+>>>>>>>>>>>>>>>>+<[>-]>[-<<<<<<<->>>>>>>>]<<<<+<[>-]>[-<<<<-<<<<<<+>>>>>>>>>>>]<<<<<]>>>>>>[-]<<<[-]" \
+    "<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>[-" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[-<<<<<<<<<--------------->>>>>>>>>>>>+<<<<<<<<" \
+    "<<<+<[>-]>[-<<<<+>>>>>>>>>>>>>>>-<<<<<<<<<<]>>>>>>>>>>[<<<<<<<<<<<<++++++++++++++++>>>>>>>>>>>>[-]]<<<]<<<" \
+    "<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<" \
+    "+>>>>>>>>>>>>>>>>>>>>>]<<<[-<<<--------------->>>>>>+<<<<<+<[>-]>[-<<<<+>>>>>>>>>-<<<<]>>>>[<<<<<<++++++++" \
+    "++++++++>>>>>>[-]]<<<]<<<<<<<<<<<<<<<<<<<<<<<<[-]>>>>>>[-]>>>>>>[->>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<]>>>>>>>" \
+    ">>>>>>>>[-<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>]<<<[-[<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>[-]]]<<<<<<[->>>>>>+>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>>]<<<[-[<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-]]]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>]+<<<[<<<<<<<<<<<<<<<<<<<<<<<<<<<->>>>>>>>>>>>>>>>>>>>>>>>>>>[-]>>>-<<<]>>>[<<<<<" \
+    "<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[-<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>+>>" \
+    ">+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>]<<<[-<<<<<<--------------->>>>>>>>>+<<<<<<<<+<[>-]>[-<<<<<<<+>>>>>>>>>>>>>>>-<<<<<<<]" \
+    ">>>>>>>[<<<<<<<<<++++++++++++++++>>>>>>>>>[-]]<<<]<<<]<<<[-]<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>+<<<+<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>]>>>[<<<<<<<<<++++++++++++++++<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>+>>>>>>+<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>" \
+    ">>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>+>>>>>>+<" \
+    "<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>]>>>[-]]<<<<<<<<<<<" \
+    "<<<<<<<[->>>>>>>>>>>>>>>+>>>>>>+<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<+>>>>>>>" \
+    ">>>>>>>>>>>>>>]<<<<<<[-<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>]<<<[-<<<--------------->>>>>>+<<<<<+<[>-]>[-<" \
+    "<<<<<<+>>>>>>>>>>>>-<<<<]>>>>[<<<<<<++++++++++++++++>>>>>>[-]]<<<]<<<<<<]>>>[-]<<<<<<<<<<<<<<<<<<<<<[->>>>" \
+    ">>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>" \
+    ">]<<<[<<<++++++++++++++++<<<<<<<<<<<<[->>>>>>>>>>>>+>>>>>>+<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>[-<<<<<<<<" \
+    "<<<<<<<<<<+>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>+>>>>>>+<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>" \
+    ">[-<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>]<<<[-]]<<<<<<[->>>>>>+>>>+<<<<<<<<<]>>>>>>>>>[-<<<<<<<<<+>>>>>>>>" \
+    ">]<<<<<<[->>>+>>>+<<<<<<]>>>>>>[-<<<<<<+>>>>>>]<<<--------------------------------------------------------" \
+    "---------[->>>>>>>>>+>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<+>>>>>" \
+    ">>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>+>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>" \
+    "[-<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<" \
+    "<<<<<<<]>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>]<<<[<<<+>>>[-]]<<<[<<<<<<->>>+<" \
+    "<<<<<<<<+>>>>>>>+<[>-]>[->>>>>-<<<<]>>+<[>-]>[->>-<<<<<<<<<+>>>>>>>>]>]<<<<<<[-]>>>[-]<<<<<+<[>-]>[-<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<[-]" \
+    ">>>[-]>>>[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>>+<<<+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]+>>>[[-]<<<->>>]<<" \
+    "<[<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+<<<+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]>>>[-<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>+<<<+<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>]>>>[->>>>>>---------------<<<<<<<<<+>>>>>>>>>>+<" \
+    "[>-]>[-<<<<<<<<<<<<<<<<<<<+>>>>>>>>>->>>>>>>>>>>]<<<<<<<<<<<[>>>>>>>>>++++++++++++++++<<<<<<<<<[-]]>>>]>>>" \
+    "]>>>[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>" \
+    ">+>>>>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>+<<<<<<+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]>>>>>>[<<<<<<<<<<<<<<<<<<++++++++++++++++>>>>>>>>>>>>>>>>>>" \
+    "[-]]<<<[-]]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+>>>+<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>]<<<[<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>+>>>>>>>>>>>>>>>>>>+<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<[-]]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+<<<<<<+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>+<<<<<<+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]>>>>>>->+<[>-]>[-<<<<+>>>>>" \
+    "]<<+[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[-]>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>]>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>+>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[" \
+    "-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<[-]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+<<<[<<<<<<<<<<<<<" \
+    "<<[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<-->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>]>>>>>>>>>>>>>>>[-]>>>-<<<]>>>[<<<<<<<<<<<<<<<<<<[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<++" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>]>>>>>>>>>>>>>>>>>>-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[->>>>>>+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>+<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>" \
+    "]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>->+<[>-]>[->>>>>-<<<<]>>>>>>>>>>>>>" \
+    ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>-]<<<<<<<<<[-]>>>[-]<<<<<<-]<<<<<<<<<<<<<<<[-]>>>[-]>>>[-]>>>[-]<<<<<<<<<" \
+    "<<<<<<<<<[-]>>>>>>[-]<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>++++++++++++++++++++++++++++++++<<<<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>>>>>>>>>>+<<<+<<<<<<<<<<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>>>>>>>" \
+    ">>>[-<<<<<<<<<<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>>>>>>>>>>]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>" \
+    "[>>>->>>++++++++++++++<<<<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<+<<<+>>>>" \
+    ">>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>->>>++++++++++++<<<<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>" \
+    ">-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>->>>-------------<<<<<<[-]]>>>[-<<<+<<<+>>>>>>]<" \
+    "<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>->>>++++++++++++++++<" \
+    "<<<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<" \
+    "<]>>>[>>>->>>------------------<<<<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<" \
+    "+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>->>>-<<<<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-" \
+    "<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>->>>-------<<<<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->" \
+    ">>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>->>>++<<<<<<[-]]>>>[-<<<+<<<+" \
+    ">>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-" \
+    "<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[" \
+    "-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[" \
+    ">>>-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<<<<]>>>[>>>-<<<[-]]>>>[-<<<+<<<+>>>>>>]<<<<<<[->>>>>>+<<<" \
+    "<<<]>>>[>>>-<<<[-]]<<<<<<<<<<<<<<<<<<<<<[->>>>>>>>>>>>>>>>>>>>>+<<<+<<<<<<<<<<<<<<<<<<]>>>>>>>>>>>>>>>>>>[" \
+    "-<<<<<<<<<<<<<<<<<<+>>>>>>>>>>>>>>>>>>]+>>>[[-]<<<->>>]<<<[>>>>>>>>>[-]+++++++++++++++++++++++++++++++++++" \
+    "+++++++++++++++++++++++++++++<<<<<<<<<-]>>>>>>>>>.[-]<<<[-]<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<[-]>>>[-]>>>[-]<<" \
+    "<<<<<<<<<<[-]>>>[-]<<<<<<<<<+<<<-]>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>++++++++++.[-]<<<<<<<<<<<<<" \
+    "<<<<<<<<<<<<<<<<<<<<<<<<<<--<<<<<<<<<-]"
+
+// Writes back every value that it reads, until the input ends.
+#define ECHO_SOURCE ",+[-.,+]"
+
+static const struct Workload workloads[] = {
+    { "squares", SQUARES_SOURCE, 20, false, false },
+    { "printer", PRINTER_SOURCE, 1, false, true },
+    { "nested", NESTED_SOURCE, 4, false, true },
+    { "sweep", SWEEP_SOURCE, 20, false, true },
+    { "mandelbrot", MANDELBROT_SOURCE, 1, false, true },
+    { "echo", ECHO_SOURCE, 1, true, false }
+};
+
+/**
+ * Represents the I/O of a benchmark, which writes to nowhere and reads from memory.
+ */
+struct BenchIo {
+    // The input, and the index of the next byte to read.
+    const uint8_t* input;
+    size_t inputSize;
+    size_t inputIndex;
+    // The amount of bytes that were written.
+    uint64_t outputSize;
+    // The time spent inside the I/O functions, in seconds.
+    double seconds;
+};
+
+/**
+ * Gets the current time of a monotonic clock.
+ *
+ * @return The time, in seconds.
+ */
+static double now(void) {
+#if defined(NIB_BENCH_POSIX)
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+#elif defined(NIB_BENCH_WINDOWS)
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+#endif
+}
+
+/**
+ * Gets the peak resident set size of the process.
+ *
+ * @return The peak resident set size, in kilobytes, or 0 if it's not known.
+ */
+static uint64_t peakMemory(void) {
+#if defined(NIB_BENCH_POSIX)
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return (uint64_t) usage.ru_maxrss / 1024;
+#else
+    return (uint64_t) usage.ru_maxrss;
+#endif
+#elif defined(NIB_BENCH_WINDOWS)
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return (uint64_t) counters.PeakWorkingSetSize / 1024;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Gets the amount of processors that can run threads.
+ *
+ * @return The amount of processors, which is at least 1.
+ */
+static uint32_t countProcessors(void) {
+#if defined(NIB_BENCH_POSIX)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t) count : 1;
+#elif defined(NIB_BENCH_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (uint32_t) info.dwNumberOfProcessors : 1;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * Counts the bytes that a script writes, without writing them anywhere.
+ *
+ * @param[in] context The I/O of the benchmark.
+ * @param[in] bytes The bytes to write, which are not used.
+ * @param[in] size The amount of bytes to write.
+ *
+ * @return true, as the bytes are always written.
+ */
+static bool writeBenchOutput(void* context, const uint8_t* bytes, const size_t size) {
+    struct BenchIo* io = (struct BenchIo*) context;
+    const double start = now();
+
+    (void) bytes;
+    io->outputSize += size;
+
+    io->seconds += now() - start;
+    return true;
+}
+
+/**
+ * Reads bytes from the input of the benchmark.
+ *
+ * @param[in] context The I/O of the benchmark.
+ * @param[out] bytes The bytes that were read.
+ * @param[in] size The maximum amount of bytes to read.
+ *
+ * @return The amount of bytes that were read, or 0 if the input has ended.
+ */
+static size_t readBenchInput(void* context, uint8_t* bytes, size_t size) {
+    struct BenchIo* io = (struct BenchIo*) context;
+    const double start = now();
+
+    if(size > io->inputSize - io->inputIndex)
+        size = io->inputSize - io->inputIndex;
+    memcpy(bytes, io->input + io->inputIndex, size);
+    io->inputIndex += size;
+
+    io->seconds += now() - start;
+    return size;
+}
+
+/**
+ * Encodes a BF script to nibbles, padding the last byte if needed.
+ *
+ * @param[in] source The BF script.
+ * @param[out] size The size of the encoded script, in bytes.
+ *
+ * @return The encoded script, or NULL if it could not be allocated.
+ */
+static uint8_t* encode(const char* source, uint32_t* size) {
+    const size_t length = strlen(source);
+    uint8_t* result = (uint8_t*) malloc(length / 2 + 1);
+    if(result == NULL)
+        return NULL;
+
+    uint32_t count = 0;
+    for(const char* character = source; *character != '\0'; ++character) {
+        uint8_t nibble;
+
+        switch(*character) {
+            case '>': nibble = NIB_INCREMENT_POINTER; break;
+            case '<': nibble = NIB_DECREMENT_POINTER; break;
+            case '+': nibble = NIB_INCREMENT_VALUE; break;
+            case '-': nibble = NIB_DECREMENT_VALUE; break;
+            case '.': nibble = NIB_WRITE_VALUE; break;
+            case ',': nibble = NIB_READ_VALUE; break;
+            case '[': nibble = NIB_LOOP_START; break;
+            case ']': nibble = NIB_LOOP_END; break;
+            default: continue;
+        }
+
+        if(count % 2 == 0)
+            *(result + count / 2) = (uint8_t) (nibble << 4u);
+        else *(result + count / 2) |= nibble;
+        ++count;
+    }
+
+    // The standard padding nibble.
+    if(count % 2 != 0)
+        *(result + count / 2) |= NIB_PADDING_BIT;
+
+    *size = (count + 1) / 2;
+    return result;
+}
+
+/**
+ * Sorts measurements, and gets their median.
+ *
+ * @param[in, out] values The measurements.
+ * @param[in] count The amount of measurements.
+ *
+ * @return The median.
+ */
+static double median(double* values, const uint32_t count) {
+    for(uint32_t i = 1; i < count; ++i) {
+        const double value = *(values + i);
+        uint32_t position = i;
+
+        for(; position > 0 && *(values + position - 1) > value; --position)
+            *(values + position) = *(values + position - 1);
+        *(values + position) = value;
+    }
+
+    return count % 2 != 0 ? *(values + count / 2) : (*(values + count / 2 - 1) + *(values + count / 2)) / 2;
+}
+
+/**
+ * Benchmarks a script with one engine, and writes the results to STDOUT as a line of JSON.
+ *
+ * Decoding, compiling, running and the I/O are measured separately. The run time includes the I/O time, and the
+ * interpretation time is the run time without it. Every phase is measured several times, and the median is used.
+ *
+ * @param[in] workload The script.
+ * @param[in] engine The type of interpreter.
+ * @param[in] safe Whether or not to use the safe interpreter.
+ * @param[in] paged Whether or not to use the paged data array.
+ * @param[in] cellBits The amount of bits in every value of the data array.
+ * @param[in] repetitions The amount of measurements.
+ * @param[in] input The echo input.
+ *
+ * @return Whether or not the script was run until its end every time.
+ */
+static bool benchmark(const struct Workload* workload, const enum NIB_ENGINE engine, const bool safe, const bool paged, const uint32_t cellBits, const uint32_t repetitions, const uint8_t* input) {
+    uint32_t sourceSize = 0;
+    uint8_t* source = encode(workload->source, &sourceSize);
+    double* times = (double*) malloc(4 * repetitions * sizeof(double));
+
+    struct NibOptions options;
+    nibDefaultOptions(&options);
+    options.engine = engine;
+    options.safe = safe;
+    options.paged = paged;
+    options.cellBits = cellBits;
+
+    struct BenchIo benchIo;
+    const struct NibIo io = { writeBenchOutput, readBenchInput, &benchIo };
+    nib_vm* vm = nibCreate(&options, &io);
+
+    if(source == NULL || times == NULL || vm == NULL) {
+        fprintf(stderr, "Could not allocate memory for the benchmark\n");
+        nibDestroy(vm);
+        free(times);
+        free(source);
+        return false;
+    }
+
+    double* decodeTimes = times;
+    double* compileTimes = times + repetitions;
+    double* runTimes = times + 2 * repetitions;
+    double* ioTimes = times + 3 * repetitions;
+    uint64_t steps = 0;
+    uint64_t outputSize = 0;
+    enum NIB_STATUS status = NIB_OK;
+
+    for(uint32_t repetition = 0; repetition < repetitions && status == NIB_OK; ++repetition) {
+        // Decode and compile the script on their own, as loading it does both at once.
+        uint8_t* decoded = NULL;
+        struct Operation* program = NULL;
+        uint32_t programSize = 0;
+        uint64_t errorIndex = 0;
+
+        double start = now();
+        const size_t decodedSize = decode(source, sourceSize, &decoded);
+        *(decodeTimes + repetition) = now() - start;
+
+        start = now();
+        if(decoded != NULL)
+            status = compile(decoded, decodedSize, &program, &programSize, NULL, &errorIndex);
+        else status = NIB_ERROR_MEMORY;
+        *(compileTimes + repetition) = now() - start;
+
+        free(decoded);
+        freeAll(OPERATION, 1, &program);
+
+        if(status == NIB_OK)
+            status = nibLoad(vm, source, sourceSize);
+
+        benchIo.outputSize = 0;
+        benchIo.seconds = 0;
+        steps = 0;
+
+        start = now();
+        for(uint32_t run = 0; run < workload->runs && status == NIB_OK; ++run) {
+            benchIo.input = input;
+            benchIo.inputSize = workload->readsInput ? ECHO_INPUT_SIZE : 0;
+            benchIo.inputIndex = 0;
+
+            nibReset(vm);
+            status = nibRun(vm, 0);
+            // Runs without a limit start with every step, so the ones that are left give the amount that was taken.
+            steps += UINT64_MAX - vm->steps;
+        }
+        *(runTimes + repetition) = now() - start;
+        *(ioTimes + repetition) = benchIo.seconds;
+        outputSize = benchIo.outputSize;
+    }
+
+    if(status == NIB_OK) {
+        const double decodeTime = median(decodeTimes, repetitions);
+        const double compileTime = median(compileTimes, repetitions);
+        const double runTime = median(runTimes, repetitions);
+        const double ioTime = median(ioTimes, repetitions);
+        const double interpretTime = runTime > ioTime ? runTime - ioTime : 0;
+        static const char* engineNames[] = { "classic", "threaded", "jit" };
+
+        printf("{\"workload\":\"%s\",\"engine\":\"%s\",\"safe\":%s,\"paged\":%s,\"cell_bits\":%u,\"repetitions\":%u,\"runs\":%u,"
+               "\"decode_seconds\":%.9f,\"compile_seconds\":%.9f,\"run_seconds\":%.9f,\"io_seconds\":%.9f,"
+               "\"interpret_seconds\":%.9f,\"steps\":%llu,\"steps_per_second\":%.0f,\"output_bytes\":%llu,"
+               "\"peak_rss_kb\":%llu}\n",
+               workload->name, engineNames[engine], safe ? "true" : "false", paged ? "true" : "false", cellBits, repetitions, workload->runs,
+               decodeTime, compileTime, runTime, ioTime, interpretTime, (unsigned long long) steps,
+               runTime > 0 ? (double) steps / runTime : 0, (unsigned long long) outputSize,
+               (unsigned long long) peakMemory());
+        fflush(stdout);
+    } else fprintf(stderr, "%s: Could not run the script\n", workload->name);
+
+    nibDestroy(vm);
+    free(times);
+    free(source);
+
+    return status == NIB_OK;
+}
+
+/**
+ * Benchmarks loading a large script with an amount of threads, and writes the result to STDOUT as a line of JSON.
+ *
+ * The script repeats every workload until it is LOAD_SIZE bytes large. Loading it is measured several times, and
+ * the median is used.
+ *
+ * @param[in] source The script.
+ * @param[in] sourceSize The size of the script, in bytes.
+ * @param[in] threadCount The amount of threads that load the script.
+ * @param[in] repetitions The amount of measurements.
+ *
+ * @return Whether or not the script was loaded every time.
+ */
+static bool benchmarkLoad(const uint8_t* source, const size_t sourceSize, const uint32_t threadCount, const uint32_t repetitions) {
+    double* times = (double*) malloc(repetitions * sizeof(double));
+
+    struct NibOptions options;
+    nibDefaultOptions(&options);
+    options.loadThreads = threadCount;
+
+    nib_vm* vm = nibCreate(&options, NULL);
+
+    if(times == NULL || vm == NULL) {
+        fprintf(stderr, "Could not allocate memory for the benchmark\n");
+        nibDestroy(vm);
+        free(times);
+        return false;
+    }
+
+    enum NIB_STATUS status = NIB_OK;
+    for(uint32_t repetition = 0; repetition < repetitions && status == NIB_OK; ++repetition) {
+        const double start = now();
+        status = nibLoad(vm, source, sourceSize);
+        *(times + repetition) = now() - start;
+    }
+
+    if(status == NIB_OK) {
+        const double loadTime = median(times, repetitions);
+
+        printf("{\"workload\":\"load\",\"threads\":%u,\"repetitions\":%u,\"script_bytes\":%llu,\"operations\":%u,"
+               "\"load_seconds\":%.9f,\"gigabytes_per_second\":%.3f,\"peak_rss_kb\":%llu}\n",
+               threadCount, repetitions, (unsigned long long) sourceSize, vm->programSize, loadTime,
+               loadTime > 0 ? (double) sourceSize / loadTime / 1e9 : 0, (unsigned long long) peakMemory());
+        fflush(stdout);
+    } else fprintf(stderr, "load: Could not load the script with %u threads\n", threadCount);
+
+    nibDestroy(vm);
+    free(times);
+
+    return status == NIB_OK;
+}
+
+/**
+ * Benchmarks loading a large script with 1 thread, and then with twice as many until the largest amount is reached.
+ *
+ * @param[in] repetitions The amount of measurements.
+ * @param[in] maxThreads The largest amount of threads.
+ *
+ * @return Whether or not the script was loaded every time.
+ */
+static bool benchmarkLoads(const uint32_t repetitions, const uint32_t maxThreads) {
+    const uint32_t workloadCount = sizeof(workloads) / sizeof(*workloads);
+    uint8_t* scripts[sizeof(workloads) / sizeof(*workloads)];
+    uint32_t scriptSizes[sizeof(workloads) / sizeof(*workloads)];
+    uint8_t* source = (uint8_t*) malloc(LOAD_SIZE);
+    bool succeeded = source != NULL;
+
+    for(uint32_t index = 0; index < workloadCount; ++index) {
+        scripts[index] = encode(workloads[index].source, scriptSizes + index);
+        succeeded = succeeded && scripts[index] != NULL;
+    }
+
+    if(succeeded) {
+        // Every workload is balanced, so the whole script is as well.
+        size_t sourceSize = 0;
+        for(uint32_t index = 0; sourceSize + scriptSizes[index] <= LOAD_SIZE; index = (index + 1) % workloadCount) {
+            memcpy(source + sourceSize, scripts[index], scriptSizes[index]);
+            sourceSize += scriptSizes[index];
+        }
+
+        for(uint32_t threadCount = 1; succeeded; threadCount *= 2) {
+            if(threadCount > maxThreads)
+                threadCount = maxThreads;
+
+            succeeded = benchmarkLoad(source, sourceSize, threadCount, repetitions);
+            if(threadCount == maxThreads)
+                break;
+        }
+    } else fprintf(stderr, "Could not allocate memory for the benchmark\n");
+
+    for(uint32_t index = 0; index < workloadCount; ++index)
+        free(scripts[index]);
+    free(source);
+
+    return succeeded;
+}
+
+/**
+ * The main function.
+ *
+ * The benchmarks are run with every engine, both normally and safely. Only the given workloads are run, or all of
+ * them if none are given. With --paged, the data array is paged, which uses the threaded interpreter for every
+ * engine. With --cell-bits, the values have the given width, which uses the threaded interpreter for every engine
+ * unless it's 8. The scripts that count down from 0 are then left out, unless they are given. With --load, only
+ * loading a large script is benchmarked instead, with more and more threads up to the amount given by -j, or up to
+ * one for every processor.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The command-line arguments.
+ *
+ * @return The program exit code.
+ */
+int main(int argc, char** argv) {
+    uint32_t repetitions = REPETITIONS;
+    const uint32_t workloadCount = sizeof(workloads) / sizeof(*workloads);
+    bool selected[sizeof(workloads) / sizeof(*workloads)];
+    bool anySelected = false;
+    bool paged = false;
+    bool load = false;
+    uint32_t maxThreads = 0;
+    uint32_t cellBits = 8;
+
+    memset(selected, 0, sizeof(selected));
+
+    for(++argv, --argc; argc > 0; --argc, ++argv) {
+        if(strcmp("-r", *argv) == 0 || strcmp("--repetitions", *argv) == 0) {
+            if(argc == 1) {
+                fprintf(stderr, "Expected repetition count\n");
+                return 1;
+            }
+            repetitions = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if(repetitions == 0 || errno == ERANGE) {
+                fprintf(stderr, "Invalid repetition count\n");
+                return 1;
+            }
+            continue;
+        }
+        if(strcmp("--paged", *argv) == 0) {
+            paged = true;
+            continue;
+        }
+        if(strcmp("--load", *argv) == 0) {
+            load = true;
+            continue;
+        }
+        if(strcmp("-j", *argv) == 0 || strcmp("--jobs", *argv) == 0) {
+            if(argc == 1) {
+                fprintf(stderr, "Expected thread count\n");
+                return 1;
+            }
+            maxThreads = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if(maxThreads == 0 || errno == ERANGE) {
+                fprintf(stderr, "Invalid thread count\n");
+                return 1;
+            }
+            continue;
+        }
+        if(strcmp("--cell-bits", *argv) == 0) {
+            if(argc == 1) {
+                fprintf(stderr, "Expected cell width\n");
+                return 1;
+            }
+            cellBits = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if(cellBits != 8 && cellBits != 16 && cellBits != 32) {
+                fprintf(stderr, "Invalid cell width\n");
+                return 1;
+            }
+            continue;
+        }
+
+        uint32_t index = 0;
+        while(index < workloadCount && strcmp(workloads[index].name, *argv) != 0)
+            ++index;
+
+        if(index == workloadCount) {
+            fprintf(stderr, "Invalid workload '%s'\n", *argv);
+            return 1;
+        }
+        selected[index] = true;
+        anySelected = true;
+    }
+
+    if(load)
+        return benchmarkLoads(repetitions, maxThreads != 0 ? maxThreads : countProcessors()) ? 0 : 1;
+
+    bool succeeded = true;
+    uint8_t* input = NULL;
+
+    for(uint32_t index = 0; index < workloadCount; ++index) {
+        if(anySelected ? !selected[index] : workloads[index].wraps && cellBits != 8)
+            continue;
+
+        // The echo input is only allocated when it's needed, so that it doesn't count towards the peak memory of
+        // the other workloads. It's the same every time, and never contains the value that stops the echo.
+        if(workloads[index].readsInput && input == NULL) {
+            input = (uint8_t*) malloc(ECHO_INPUT_SIZE);
+            if(input == NULL) {
+                fprintf(stderr, "Could not allocate memory for the benchmark\n");
+                return 1;
+            }
+
+            uint32_t seed = 0x4E4942u;
+            for(uint32_t i = 0; i < ECHO_INPUT_SIZE; ++i) {
+                seed = seed * 1664525u + 1013904223u;
+                *(input + i) = (uint8_t) (seed >> 24u) == UINT8_MAX ? 0 : (uint8_t) (seed >> 24u);
+            }
+        }
+
+        for(uint32_t engine = NIB_ENGINE_CLASSIC; engine <= NIB_ENGINE_JIT; ++engine) {
+            succeeded = benchmark(workloads + index, (enum NIB_ENGINE) engine, false, paged, cellBits, repetitions, input) && succeeded;
+            succeeded = benchmark(workloads + index, (enum NIB_ENGINE) engine, true, paged, cellBits, repetitions, input) && succeeded;
+        }
+    }
+
+    free(input);
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,491 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Needed for mmap() when compiling in strict C11 mode.
+#define _DEFAULT_SOURCE
+
+#include "nib.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NIB_CACHE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#elif defined(_WIN32)
+// The offsets of ftell() are only 32-bit on Windows.
+#define fseek _fseeki64
+#define ftell _ftelli64
+#endif
+
+#define CACHE_MAGIC "NIBC"
+// Change this whenever the layout of the cache or the meaning of the operations changes.
+#define CACHE_VERSION 5u
+// Written in the native byte order, so that caches from machines with another byte order are rejected.
+#define CACHE_BYTE_ORDER 0x01020304u
+
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15u
+
+/**
+ * Represents the start of a cache file, which is followed by the compiled operations, including the OP_END operation,
+ * and by the values and the output of the snapshot, if there is one.
+ *
+ * The operations are stored exactly like they are in memory, so that they can be used straight from the mapped file.
+ */
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    // The size of an operation, which changes with the layout of the operations.
+    uint32_t operationSize;
+    // The hash and the size of the script that the operations were compiled from.
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    // The amount of operations, without the OP_END operation.
+    uint32_t programSize;
+    struct IdiomStatistics idioms;
+    // The options that the snapshot was precomputed with, which are all 0 if there is none: the maximum amount of
+    // steps and of values, and the width of the values.
+    uint64_t snapshotSteps;
+    uint64_t snapshotLimit;
+    uint32_t snapshotCellBits;
+    // The snapshot, whose values and output follow the operations.
+    uint32_t programIndex;
+    uint64_t dataIndex;
+    uint64_t steps;
+    uint64_t usedValues;
+    uint64_t cellCount;
+    uint64_t outputSize;
+};
+
+/**
+ * Hashes a script, so that cache files can be matched with the script that they were compiled from.
+ *
+ * @param[in] source The script.
+ * @param[in] size The size of the script, in bytes.
+ *
+ * @return The hash of the script.
+ */
+static uint64_t hashSource(const uint8_t* source, const size_t size) {
+    uint64_t hash = (uint64_t) size * HASH_MULTIPLIER;
+    size_t index = 0;
+
+    // Hash 8 bytes at a time, so that large scripts are hashed much faster than they are compiled.
+    for(; index + sizeof(uint64_t) <= size; index += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, source + index, sizeof(uint64_t));
+
+        hash = (hash ^ word) * HASH_MULTIPLIER;
+        hash ^= hash >> 29u;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, source + index, size - index);
+    hash = (hash ^ tail) * HASH_MULTIPLIER;
+
+    // Mix the last bytes into every bit.
+    hash ^= hash >> 33u;
+    hash *= 0xFF51AFD7ED558CCDu;
+    hash ^= hash >> 33u;
+    hash *= 0xC4CEB9FE1A85EC53u;
+    hash ^= hash >> 33u;
+    return hash;
+}
+
+/**
+ * Checks whether or not the header of a cache file belongs to a script.
+ *
+ * @param[in] header The header of the cache file.
+ * @param[in] fileSize The size of the cache file, in bytes.
+ * @param[in] sourceHash The hash of the script.
+ * @param[in] sourceSize The size of the script, in bytes.
+ *
+ * @return Whether or not the operations of the cache file can be used for the script.
+ */
+static bool validHeader(const struct CacheHeader* header, const uint64_t fileSize, const uint64_t sourceHash, const uint64_t sourceSize) {
+    if(memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0
+        || header->version != CACHE_VERSION
+        || header->byteOrder != CACHE_BYTE_ORDER
+        || header->operationSize != sizeof(struct Operation)
+        || header->sourceHash != sourceHash
+        || header->sourceSize != sourceSize
+        || header->programSize >= UINT32_MAX)
+        return false;
+
+    // Without a snapshot, its sizes are 0. Otherwise, it resumes inside the program and only uses the values that it
+    // can hold.
+    const uint64_t cellSize = header->snapshotCellBits / 8;
+    if(header->snapshotSteps == 0) {
+        if(header->cellCount != 0 || header->outputSize != 0)
+            return false;
+    } else if((header->snapshotCellBits != 8 && header->snapshotCellBits != 16 && header->snapshotCellBits != 32)
+        || header->snapshotLimit > NIB_SNAPSHOT_LIMIT
+        || header->programIndex > header->programSize
+        || header->usedValues > header->snapshotLimit
+        || header->cellCount > header->usedValues
+        || header->dataIndex >= header->usedValues
+        || header->outputSize > NIB_SNAPSHOT_LIMIT + NIB_BALANCED_LIMIT) {
+        return false;
+    }
+
+    return fileSize == sizeof(struct CacheHeader) + ((uint64_t) header->programSize + 1) * sizeof(struct Operation) + header->cellCount * cellSize + header->outputSize;
+}
+
+/**
+ * Checks whether or not the operations of a cache file can be run, so that a damaged cache file never makes the
+ * interpreters jump outside of the program.
+ *
+ * @param[in] program The operations, followed by an OP_END operation.
+ * @param[in] programSize The amount of operations, without the OP_END operation.
+ * @param[in] resumeIndex The index of the operation that the snapshot resumes from, or UINT32_MAX if there is none.
+ *
+ * @return Whether or not the operations can be run.
+ */
+static bool validProgram(const struct Operation* program, const uint32_t programSize, const uint32_t resumeIndex) {
+    // The copy of the balanced loop that was last checked, and the offsets that its OP_RANGE checks.
+    uint32_t copyStart = 0;
+    uint32_t copyEnd = 0;
+    int32_t lowestOffset = 0;
+    int32_t highestOffset = 0;
+
+    for(uint32_t i = 0; i < programSize; ++i) {
+        const struct Operation* operation = program + i;
+
+        // Runs never start inside a copy or between multiplications.
+        if(i == resumeIndex && (operation->type == OP_MULTIPLY_ADD || (copyEnd != 0 && i >= copyStart && i <= copyEnd)))
+            return false;
+
+        // The copies never move, and only use the values that were checked.
+        if(i > copyStart && i < copyEnd) {
+            if((operation->type != OP_ADD && operation->type != OP_WRITE && operation->type != OP_READ && operation->type != OP_CLEAR) || operation->offset < lowestOffset || operation->offset > highestOffset)
+                return false;
+            continue;
+        }
+
+        switch(operation->type) {
+            case OP_ADD:
+            case OP_WRITE:
+            case OP_READ:
+            case OP_CLEAR: {
+                if(operation->offset != 0)
+                    return false;
+                break;
+            }
+            case OP_MOVE:
+            case OP_MULTIPLY_ADD: {
+                break;
+            }
+            case OP_LOOP_START: {
+                if(operation->jump <= i || operation->jump >= programSize || (program + operation->jump)->type != OP_LOOP_END || (program + operation->jump)->jump != i)
+                    return false;
+                break;
+            }
+            case OP_LOOP_END: {
+                if(operation->jump >= i || (program + operation->jump)->type != OP_LOOP_START || (program + operation->jump)->jump != i)
+                    return false;
+                break;
+            }
+            case OP_MULTIPLY: {
+                if(operation->count < 0 || (uint32_t) operation->count > NIB_MULTIPLY_LIMIT || (uint64_t) i + (uint32_t) operation->count >= programSize)
+                    return false;
+                for(uint32_t j = 1; j <= (uint32_t) operation->count; ++j) {
+                    if((operation + j)->type != OP_MULTIPLY_ADD)
+                        return false;
+                }
+                if(operation->jump <= i || operation->jump >= programSize || (program + operation->jump)->type != OP_LOOP_END)
+                    return false;
+                break;
+            }
+            case OP_SCAN: {
+                if(operation->jump <= i || operation->jump >= programSize || (program + operation->jump)->type != OP_LOOP_END)
+                    return false;
+                break;
+            }
+            case OP_RANGE: {
+                // The original loop follows, and its copy follows the original loop.
+                if(operation->offset > 0 || operation->count < 0 || operation->jump <= i + 1 || operation->jump >= programSize - 1 || (program + i + 1)->type != OP_LOOP_START || (program + i + 1)->jump != operation->jump || (program + operation->jump + 1)->type != OP_LOOP_START)
+                    return false;
+
+                copyStart = operation->jump + 1;
+                copyEnd = (program + copyStart)->jump;
+                lowestOffset = operation->offset;
+                highestOffset = operation->count;
+                break;
+            }
+            default: {
+                return false;
+            }
+        }
+    }
+
+    return (program + programSize)->type == OP_END;
+}
+
+/**
+ * Checks whether or not the snapshot of a cache file was precomputed with the options of a virtual machine.
+ *
+ * @param[in] vm The virtual machine.
+ * @param[in] header The header of the cache file.
+ *
+ * @return Whether or not the snapshot can be used.
+ */
+static bool matchingSnapshot(const nib_vm* vm, const struct CacheHeader* header) {
+    return header->snapshotSteps != 0
+        && header->snapshotSteps == vm->options.precomputeSteps
+        && header->snapshotCellBits == vm->options.cellBits
+        && header->snapshotLimit == snapshotLimit(vm)
+        && !vm->options.profile;
+}
+
+/**
+ * Makes the snapshot of a cache file the snapshot of a virtual machine.
+ *
+ * @param[in, out] vm The virtual machine, which has no snapshot.
+ * @param[in] header The header of the cache file.
+ * @param[in] cells The values of the snapshot, which are followed by its output.
+ * @param[in] memory The memory that holds the values and the output, or NULL if they are mapped. It's freed if the
+ * snapshot can't be allocated, in which case the virtual machine has no snapshot.
+ */
+static void useSnapshot(nib_vm* vm, const struct CacheHeader* header, const uint8_t* cells, uint8_t* memory) {
+    struct Snapshot* snapshot = (struct Snapshot*) malloc(sizeof(struct Snapshot));
+    if(snapshot == NULL) {
+        free(memory);
+        return;
+    }
+
+    snapshot->programIndex = header->programIndex;
+    snapshot->dataIndex = (size_t) header->dataIndex;
+    snapshot->steps = header->steps;
+    snapshot->usedValues = (size_t) header->usedValues;
+    snapshot->cells = cells;
+    snapshot->cellCount = (size_t) header->cellCount;
+    snapshot->output = cells + header->cellCount * (header->snapshotCellBits / 8);
+    snapshot->outputSize = (size_t) header->outputSize;
+    snapshot->memory = memory;
+
+    vm->snapshot = snapshot;
+}
+
+/**
+ * Replaces the program of a virtual machine with the one from a cache file, if the cache file belongs to the script.
+ *
+ * The cache file is mapped in memory if possible, and read otherwise. Its snapshot is only kept if it was
+ * precomputed with the options of the virtual machine.
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in] path The path of the cache file.
+ * @param[in] sourceHash The hash of the script.
+ * @param[in] sourceSize The size of the script, in bytes.
+ *
+ * @return Whether or not the program was replaced.
+ */
+static bool readCache(nib_vm* vm, const char* path, const uint64_t sourceHash, const uint64_t sourceSize) {
+#ifdef NIB_CACHE_MMAP
+    const int file = open(path, O_RDONLY);
+    if(file < 0)
+        return false;
+
+    struct stat status;
+    uint8_t* contents = MAP_FAILED;
+
+    if(fstat(file, &status) == 0 && S_ISREG(status.st_mode) && (uint64_t) status.st_size >= sizeof(struct CacheHeader) && (uint64_t) status.st_size <= SIZE_MAX)
+        contents = (uint8_t*) mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if(contents == MAP_FAILED)
+        return false;
+
+    const size_t fileSize = (size_t) status.st_size;
+    const struct CacheHeader* header = (const struct CacheHeader*) contents;
+    struct Operation* program = (struct Operation*) (contents + sizeof(struct CacheHeader));
+
+    if(!validHeader(header, fileSize, sourceHash, sourceSize) || !validProgram(program, header->programSize, header->snapshotSteps != 0 ? header->programIndex : UINT32_MAX)) {
+        munmap(contents, fileSize);
+        return false;
+    }
+
+    prepareLoad(vm);
+    freeAll(OPERATION, 1, &vm->program);
+
+    vm->program = program;
+    vm->programSize = header->programSize;
+    vm->idioms = header->idioms;
+    vm->programMapping = contents;
+    vm->programMappingSize = fileSize;
+
+    // The snapshot is used straight from the mapped file as well.
+    if(matchingSnapshot(vm, header))
+        useSnapshot(vm, header, (const uint8_t*) (program + header->programSize + 1), NULL);
+    return true;
+#else
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+        return false;
+
+    // Without mmap(), the operations are read into the array of the previous program.
+    struct CacheHeader header;
+    fseek(file, 0, SEEK_END);
+    const int64_t fileSize = (int64_t) ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if(fileSize < 0 || fread(&header, sizeof(header), 1, file) != 1 || !validHeader(&header, (uint64_t) fileSize, sourceHash, sourceSize)) {
+        fclose(file);
+        return false;
+    }
+
+    const size_t operationCount = (size_t) header.programSize + 1;
+    struct Operation* program = operationCount <= SIZE_MAX / sizeof(struct Operation) ? (struct Operation*) malloc(operationCount * sizeof(struct Operation)) : NULL;
+    bool valid = program != NULL && fread(program, sizeof(struct Operation), operationCount, file) == operationCount && validProgram(program, header.programSize, header.snapshotSteps != 0 ? header.programIndex : UINT32_MAX);
+
+    // The snapshot is only read if it's used.
+    const size_t snapshotSize = (size_t) (header.cellCount * (header.snapshotCellBits / 8) + header.outputSize);
+    uint8_t* snapshot = NULL;
+    if(valid && matchingSnapshot(vm, &header)) {
+        snapshot = (uint8_t*) malloc(snapshotSize + 1);
+        valid = snapshot != NULL && fread(snapshot, 1, snapshotSize, file) == snapshotSize;
+    }
+    fclose(file);
+
+    if(!valid) {
+        free(program);
+        free(snapshot);
+        return false;
+    }
+
+    prepareLoad(vm);
+    freeAll(OPERATION, 1, &vm->program);
+
+    vm->program = program;
+    vm->programSize = header.programSize;
+    vm->idioms = header.idioms;
+
+    if(snapshot != NULL)
+        useSnapshot(vm, &header, snapshot, snapshot);
+    return true;
+#endif
+}
+
+/**
+ * Writes the program of a virtual machine, and its snapshot if it has one, to a cache file.
+ *
+ * The program is written to a temporary file first, which then replaces the cache file, so that a partially
+ * written cache file is never read.
+ *
+ * @param[in] vm The virtual machine, which has a program.
+ * @param[in] path The path of the cache file.
+ * @param[in] sourceHash The hash of the script.
+ * @param[in] sourceSize The size of the script, in bytes.
+ *
+ * @return Whether or not the cache file was written.
+ */
+static bool writeCache(const nib_vm* vm, const char* path, const uint64_t sourceHash, const uint64_t sourceSize) {
+    const size_t pathLength = strlen(path);
+    char* temporaryPath = (char*) malloc(pathLength + sizeof(".tmp"));
+    if(temporaryPath == NULL)
+        return false;
+
+    memcpy(temporaryPath, path, pathLength);
+    memcpy(temporaryPath + pathLength, ".tmp", sizeof(".tmp"));
+
+    FILE* file = fopen(temporaryPath, "wb");
+    if(file == NULL) {
+        free(temporaryPath);
+        return false;
+    }
+
+    struct CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+    header.operationSize = sizeof(struct Operation);
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.programSize = vm->programSize;
+    header.idioms = vm->idioms;
+
+    const struct Snapshot* snapshot = vm->snapshot;
+    if(snapshot != NULL) {
+        header.snapshotSteps = vm->options.precomputeSteps;
+        header.snapshotLimit = snapshotLimit(vm);
+        header.snapshotCellBits = vm->options.cellBits;
+        header.programIndex = snapshot->programIndex;
+        header.dataIndex = snapshot->dataIndex;
+        header.steps = snapshot->steps;
+        header.usedValues = snapshot->usedValues;
+        header.cellCount = snapshot->cellCount;
+        header.outputSize = snapshot->outputSize;
+    }
+
+    const size_t operationCount = (size_t) vm->programSize + 1;
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(vm->program, sizeof(struct Operation), operationCount, file) == operationCount;
+    if(snapshot != NULL) {
+        const size_t cellsSize = snapshot->cellCount * vm->tape.cellSize;
+        written = written && fwrite(snapshot->cells, 1, cellsSize, file) == cellsSize && fwrite(snapshot->output, 1, snapshot->outputSize, file) == snapshot->outputSize;
+    }
+    written = fclose(file) == 0 && written;
+
+    if(written) {
+#ifdef _WIN32
+        // Files can't be renamed over existing ones on Windows.
+        remove(path);
+#endif
+        written = rename(temporaryPath, path) == 0;
+    }
+    if(!written)
+        remove(temporaryPath);
+
+    free(temporaryPath);
+    return written;
+}
+
+enum NIB_STATUS nibLoadCached(nib_vm* vm, const uint8_t* source, const size_t size, const char* path) {
+    const uint64_t sourceHash = hashSource(source, size);
+
+    if(readCache(vm, path, sourceHash, size)) {
+        // A snapshot that was precomputed with other options, or not at all, is precomputed now and cached as well.
+        const bool cachedSnapshot = vm->snapshot != NULL;
+        const enum NIB_STATUS status = finishLoad(vm, NIB_OK);
+        if(status == NIB_OK && !cachedSnapshot && vm->snapshot != NULL)
+            writeCache(vm, path, sourceHash, size);
+        return status;
+    }
+
+    // The cache file is missing, outdated or damaged. Failing to write it is not an error, as it's only used to load
+    // the script faster.
+    const enum NIB_STATUS status = nibLoad(vm, source, size);
+    if(status == NIB_OK)
+        writeCache(vm, path, sourceHash, size);
+    return status;
+}
+
+void freeCache(nib_vm* vm) {
+    if(vm->programMapping == NULL)
+        return;
+
+#ifdef NIB_CACHE_MMAP
+    munmap(vm->programMapping, vm->programMappingSize);
+#endif
+    vm->programMapping = NULL;
+    vm->programMappingSize = 0;
+    vm->program = NULL;
+}
@@ -0,0 +1,37 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nib.h"
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#define NIB_SSE2
+#include <emmintrin.h>
+#endif
+
+// The functions for 8-bit values are in nib.c, so that the classic interpreter can inline them.
+#define DATA_CELL_BITS 16
+#include "data.h"
+#undef DATA_CELL_BITS
+
+#define DATA_CELL_BITS 32
+#include "data.h"
+#undef DATA_CELL_BITS
@@ -0,0 +1,317 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// This header has no include guard on purpose. It holds the loops that are replaced with faster operations. nib.c
+// includes it for 8-bit values, and data.c once for every wider one. Before including it, the following must be
+// defined:
+//
+// DATA_CELL_BITS - The width of the values, either 8, 16 or 32 bits. The functions for 8-bit values have the
+// plain names, and the others end with the width (e.g. multiplyData16).
+
+#if DATA_CELL_BITS == 16
+#define CELL uint16_t
+#define DATA(name) name##16
+#define COMPARE_ZERO _mm_cmpeq_epi16
+#elif DATA_CELL_BITS == 32
+#define CELL uint32_t
+#define DATA(name) name##32
+#define COMPARE_ZERO _mm_cmpeq_epi32
+#else
+#define CELL uint8_t
+#define DATA(name) name
+#define COMPARE_ZERO _mm_cmpeq_epi8
+#endif
+
+bool DATA(multiplyData)(nib_vm* vm, const struct Operation* operation, const size_t dataIndex) {
+    struct Tape* tape = &vm->tape;
+
+    // Let the loop deal with an invalid data index.
+#ifdef NIB_GUARD_PAGES
+    if(dataIndex >= tape->reserved)
+        return false;
+#else
+    if(dataIndex >= tape->size)
+        return false;
+#endif
+
+    // The loop doesn't run at all.
+    const CELL value = *((CELL*) tape->cells + dataIndex);
+    if(value == 0)
+        return true;
+
+    // The loop would move to a negative index, which the safe interpreter ignores and the unsafe one rejects.
+    if(operation->offset < 0 && dataIndex < (size_t) -(int64_t) operation->offset)
+        return false;
+
+    // The additions are sorted by offset, so only the last one can be past the end.
+    const struct Operation* last = operation + operation->count;
+#ifdef NIB_GUARD_PAGES
+    // The new pages are committed when they are first used, unless they were not reserved.
+    if(operation->count > 0 && last->offset > 0 && dataIndex + last->offset >= tape->reserved)
+        return false;
+#else
+    if(operation->count > 0 && last->offset > 0 && dataIndex + last->offset >= tape->size && !growTape(tape, dataIndex + last->offset))
+        raiseError(vm, NIB_ERROR_MEMORY, operation->inputIndex);
+#endif
+
+    // The values wrap around, so the products are computed without a sign.
+    CELL* cells = (CELL*) tape->cells;
+    for(const struct Operation* multiply = operation + 1; multiply <= last; ++multiply)
+        *(cells + dataIndex + multiply->offset) += (CELL) (value * (uint32_t) multiply->count);
+    *(cells + dataIndex) = 0;
+
+    return true;
+}
+
+/**
+ * Finds the first value of 0 in an array of values.
+ *
+ * @param[in] begin The start of the array.
+ * @param[in] end The end of the array, which is not searched.
+ *
+ * @return The first value of 0, or NULL if there is none.
+ */
+static const CELL* DATA(findFirstZero)(const CELL* begin, const CELL* end) {
+#if DATA_CELL_BITS == 8
+    return (const CELL*) memchr(begin, 0, (size_t) (end - begin));
+#else
+#ifdef NIB_SSE2
+    // Compare 16 bytes at once, and pick the lowest value that matched. Every byte of a value that matched is set in
+    // the mask.
+    const __m128i zero = _mm_setzero_si128();
+
+    for(; end - begin >= (ptrdiff_t) (16 / sizeof(CELL)); begin += 16 / sizeof(CELL)) {
+        const uint32_t mask = (uint32_t) _mm_movemask_epi8(COMPARE_ZERO(_mm_loadu_si128((const __m128i*) begin), zero));
+        if(mask != 0)
+            return begin + __builtin_ctz(mask) / sizeof(CELL);
+    }
+#endif
+
+    for(; begin < end; ++begin) {
+        if(*begin == 0)
+            return begin;
+    }
+    return NULL;
+#endif
+}
+
+/**
+ * Finds the last value of 0 in an array of values.
+ *
+ * @param[in] begin The start of the array.
+ * @param[in] end The end of the array, which is not searched.
+ *
+ * @return The last value of 0, or NULL if there is none.
+ */
+static const CELL* DATA(findLastZero)(const CELL* begin, const CELL* end) {
+#ifdef NIB_SSE2
+    // Compare 16 bytes at once, and pick the highest value that matched.
+    const __m128i zero = _mm_setzero_si128();
+
+    while(end - begin >= (ptrdiff_t) (16 / sizeof(CELL))) {
+        end -= 16 / sizeof(CELL);
+
+        const uint32_t mask = (uint32_t) _mm_movemask_epi8(COMPARE_ZERO(_mm_loadu_si128((const __m128i*) end), zero));
+        if(mask != 0)
+            return end + (31 - __builtin_clz(mask)) / sizeof(CELL);
+    }
+#endif
+
+    while(end > begin) {
+        if(*--end == 0)
+            return end;
+    }
+    return NULL;
+}
+
+bool DATA(scanData)(nib_vm* vm, const int32_t step, size_t* dataIndex) {
+    struct Tape* tape = &vm->tape;
+    const CELL* cells = (const CELL*) tape->cells;
+    size_t index = *dataIndex;
+
+    // Let the loop deal with an invalid data index.
+#ifdef NIB_GUARD_PAGES
+    if(index >= tape->reserved)
+        return false;
+
+    // Values past the end of the data array were never used, so they are 0 and the loop doesn't run.
+    if(index >= tape->size)
+        return true;
+#else
+    if(index >= tape->size)
+        return false;
+#endif
+
+    if(step > 0) {
+        if(step == 1) {
+            const CELL* found = DATA(findFirstZero)(cells + index, cells + tape->size);
+            index = found != NULL ? (size_t) (found - cells) : tape->size;
+        } else {
+            while(index < tape->size && *(cells + index) != 0)
+                index += step;
+        }
+
+        // The scan stops right past the end, as the new memory is filled with 0.
+#ifdef NIB_GUARD_PAGES
+        if(index >= tape->reserved)
+            return false;
+#else
+        if(index >= tape->size && !growTape(tape, index))
+            raiseError(vm, NIB_ERROR_MEMORY, 0);
+#endif
+    } else if(step == -1) {
+        const CELL* found = DATA(findLastZero)(cells, cells + index + 1);
+
+        // The loop would move to a negative index.
+        if(found == NULL)
+            return false;
+        index = (size_t) (found - cells);
+    } else {
+        const size_t distance = (size_t) -(int64_t) step;
+
+        while(*(cells + index) != 0) {
+            // The loop would move to a negative index.
+            if(index < distance)
+                return false;
+            index -= distance;
+        }
+    }
+
+    *dataIndex = index;
+    return true;
+}
+
+bool DATA(multiplyPagedData)(nib_vm* vm, const struct Operation* operation, const size_t dataIndex) {
+    struct Tape* tape = &vm->tape;
+
+    // Let the loop deal with an invalid data index. Valid ones are always on the current page, as the interpreter
+    // enters the page of every data index that it moves to.
+    if(dataIndex >= NIB_PAGED_LIMIT)
+        return false;
+
+    // The loop doesn't run at all.
+    CELL* cells = (CELL*) tape->cells;
+    const CELL value = *(cells + dataIndex);
+    if(value == 0)
+        return true;
+
+    // The loop would move to a negative index, which the safe interpreter ignores and the unsafe one rejects.
+    if(operation->offset < 0 && dataIndex < (size_t) -(int64_t) operation->offset)
+        return false;
+
+    // The additions are sorted by offset, so only the last one can be past the end.
+    const struct Operation* last = operation + operation->count;
+    if(operation->count > 0 && last->offset > 0 && dataIndex + last->offset >= NIB_PAGED_LIMIT)
+        return false;
+
+    // The lowest and the highest offsets tell whether all of the values are on the current page, which is usually
+    // the case. Otherwise, the page of every value is looked up, and allocated if needed.
+    const size_t pageStart = tape->pageStart;
+    const size_t lowest = dataIndex + operation->offset;
+    const size_t highest = last->offset > 0 ? dataIndex + last->offset : dataIndex;
+
+    if(lowest - pageStart < NIB_PAGE_SIZE && highest - pageStart < NIB_PAGE_SIZE) {
+        for(const struct Operation* multiply = operation + 1; multiply <= last; ++multiply)
+            *(cells + dataIndex + multiply->offset) += (CELL) (value * (uint32_t) multiply->count);
+    } else {
+        for(const struct Operation* multiply = operation + 1; multiply <= last; ++multiply) {
+            const size_t index = dataIndex + multiply->offset;
+
+            CELL* page = (CELL*) getPage(tape, index, true);
+            if(page == NULL)
+                raiseError(vm, NIB_ERROR_MEMORY, operation->inputIndex);
+            *(page + (index & (NIB_PAGE_SIZE - 1))) += (CELL) (value * (uint32_t) multiply->count);
+        }
+    }
+    *(cells + dataIndex) = 0;
+
+    return true;
+}
+
+bool DATA(scanPagedData)(nib_vm* vm, const int32_t step, size_t* dataIndex) {
+    struct Tape* tape = &vm->tape;
+    size_t index = *dataIndex;
+
+    // Let the loop deal with an invalid data index. Valid ones start on the current page, just like when
+    // multiplying.
+    if(index >= NIB_PAGED_LIMIT)
+        return false;
+
+    const CELL* cells = (const CELL*) tape->cells;
+    size_t pageStart = tape->pageStart;
+
+    // Negative steps wrap around, so adding them moves back.
+    const size_t stride = (size_t) (int64_t) step;
+    const size_t distance = (size_t) -(int64_t) step;
+
+    for(;;) {
+        if(step == 1) {
+            const CELL* found = DATA(findFirstZero)(cells + index, cells + pageStart + NIB_PAGE_SIZE);
+            if(found != NULL) {
+                index = (size_t) (found - cells);
+                break;
+            }
+            index = pageStart + NIB_PAGE_SIZE;
+        } else if(step == -1) {
+            const CELL* found = DATA(findLastZero)(cells + pageStart, cells + index + 1);
+            if(found != NULL) {
+                index = (size_t) (found - cells);
+                break;
+            }
+
+            // The loop would move to a negative index.
+            if(pageStart == 0)
+                return false;
+            index = pageStart - 1;
+        } else {
+            // Moving back past the start of the page wraps around as well, so both ways leave the page alike.
+            while(index - pageStart < NIB_PAGE_SIZE && *(cells + index) != 0) {
+                // The loop would move to a negative index.
+                if(step < 0 && index < distance)
+                    return false;
+                index += stride;
+            }
+
+            if(index - pageStart < NIB_PAGE_SIZE)
+                break;
+        }
+
+        // The scan went past the end of the data array.
+        if(index >= NIB_PAGED_LIMIT)
+            return false;
+
+        // Pages that were never used are filled with 0, so the scan stops at the first value that it reaches.
+        const uint8_t* page = getPage(tape, index, false);
+        if(page == NULL)
+            break;
+
+        pageStart = index & ~(NIB_PAGE_SIZE - 1);
+        cells = (const CELL*) ((uintptr_t) page - pageStart * sizeof(CELL));
+    }
+
+    *dataIndex = index;
+    return true;
+}
+
+#undef CELL
+#undef DATA
+#undef COMPARE_ZERO
@@ -0,0 +1,154 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Needed for fileno() and read() when compiling in strict C11 mode.
+#define _DEFAULT_SOURCE
+
+#include "nib.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NIB_POSIX_IO
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NIB_WINDOWS_IO
+#include <io.h>
+#endif
+
+/**
+ * Writes bytes to STDOUT.
+ *
+ * @param[in] context The context of the I/O, which is not used.
+ * @param[in] bytes The bytes to write.
+ * @param[in] size The amount of bytes to write.
+ *
+ * @return Whether or not all bytes were written.
+ */
+static bool writeStandardOutput(void* context, const uint8_t* bytes, const size_t size) {
+    (void) context;
+
+    return fwrite(bytes, 1, size, stdout) == size && fflush(stdout) == 0;
+}
+
+/**
+ * Reads bytes from STDIN, returning as soon as some are available.
+ *
+ * @param[in] context The context of the I/O, which is not used.
+ * @param[out] bytes The bytes that were read.
+ * @param[in] size The maximum amount of bytes to read.
+ *
+ * @return The amount of bytes that were read, or 0 if STDIN has ended.
+ */
+static size_t readStandardInput(void* context, uint8_t* bytes, const size_t size) {
+    (void) context;
+
+    // Unlike fread(), read() returns as soon as some input is available, so interactive scripts don't wait
+    // for the whole buffer to be filled.
+#if defined(NIB_POSIX_IO)
+    ssize_t count;
+    do {
+        count = read(STDIN_FILENO, bytes, size);
+    } while(count < 0 && errno == EINTR);
+#elif defined(NIB_WINDOWS_IO)
+    int count = _read(_fileno(stdin), bytes, (unsigned int) size);
+#else
+    (void) size;
+    int value = getchar();
+    int count = value == EOF ? 0 : 1;
+    *bytes = (uint8_t) value;
+#endif
+
+    return count > 0 ? (size_t) count : 0;
+}
+
+const struct NibIo standardIo = { writeStandardOutput, readStandardInput, NULL };
+
+bool setupBuffers(nib_vm* vm) {
+    const uint32_t bufferSize = vm->options.bufferSize;
+
+    vm->output.bytes = (uint8_t*) malloc(bufferSize);
+    vm->input.bytes = (uint8_t*) malloc(bufferSize);
+
+    if(vm->output.bytes == NULL || vm->input.bytes == NULL) {
+        freeAll(UINT8, 2, &vm->output.bytes, &vm->input.bytes);
+        return false;
+    }
+
+    vm->output.limit = bufferSize;
+    vm->input.limit = bufferSize;
+    resetBuffers(vm);
+
+    return true;
+}
+
+bool flushOutput(nib_vm* vm) {
+    if(vm->output.size == 0)
+        return true;
+
+    // The profiler measures the I/O here, as it only happens once for every buffer.
+    const double start = vm->profile != NULL ? profileClock() : 0;
+
+    const bool written = vm->io.write(vm->io.context, vm->output.bytes, vm->output.size);
+    vm->output.size = 0;
+
+    if(vm->profile != NULL)
+        vm->profile->ioSeconds += profileClock() - start;
+
+    return written;
+}
+
+bool fillInput(nib_vm* vm) {
+    if(vm->inputEnded)
+        return false;
+
+    // The script may be waiting for an answer to what it wrote, so the output must be shown before blocking.
+    if(!flushOutput(vm))
+        raiseError(vm, NIB_ERROR_OUTPUT, 0);
+
+    const double start = vm->profile != NULL ? profileClock() : 0;
+
+    const size_t size = vm->io.read(vm->io.context, vm->input.bytes, vm->input.limit);
+
+    if(vm->profile != NULL)
+        vm->profile->ioSeconds += profileClock() - start;
+
+    if(size == 0) {
+        vm->inputEnded = true;
+        return false;
+    }
+
+    vm->input.size = (uint32_t) (size < vm->input.limit ? size : vm->input.limit);
+    vm->input.index = 0;
+
+    return true;
+}
+
+void resetBuffers(nib_vm* vm) {
+    vm->output.size = 0;
+    vm->output.index = 0;
+    vm->input.size = 0;
+    vm->input.index = 0;
+    vm->inputEnded = false;
+}
+
+void freeBuffers(nib_vm* vm) {
+    freeAll(UINT8, 2, &vm->output.bytes, &vm->input.bytes);
+}
@@ -0,0 +1,583 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Needed for MAP_ANONYMOUS when compiling in strict C11 mode.
+#define _DEFAULT_SOURCE
+
+#include "nib.h"
+
+// The generated code doesn't check the data index, so it relies on the guard pages.
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__)) && defined(NIB_GUARD_PAGES)
+#define NIB_JIT_SUPPORTED
+#endif
+
+#ifdef NIB_JIT_SUPPORTED
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+// The maximum amount of machine code bytes emitted for an operation, and for the code around the operations.
+#define JIT_OPERATION_SIZE 96u
+#define JIT_EXTRA_SIZE 256u
+
+// Register usage of the generated code. All of these registers are callee-saved, so they survive calls to C.
+//
+// rbx - The data array.
+// r12 - The data index, which is 64-bit.
+// r13 - The amount of steps left.
+// r14 - The JIT state.
+// r15 - The address of the last OP_MOVE that was run (tape.operation), which is only recorded by unsafe code.
+
+struct JitProgram {
+    uint8_t* code;
+    // The size of the mapping, in bytes.
+    size_t size;
+    // The code offset of each operation, which is where a run that stopped at the operation resumes.
+    uint32_t* offsets;
+};
+
+/**
+ * Represents the state shared between the generated code and the C helpers.
+ */
+struct JitState {
+    uint8_t* data;
+    uint64_t steps;
+    // The code of the operation to start from.
+    const uint8_t* entry;
+    nib_vm* vm;
+    size_t dataIndex;
+    uint32_t programIndex;
+};
+
+/**
+ * Represents a buffer of machine code.
+ */
+struct JitBuffer {
+    uint8_t* code;
+    size_t size;
+};
+
+/**
+ * Represents a jump whose target is not known yet.
+ */
+struct JitFixup {
+    // The position of the relative jump offset.
+    size_t position;
+    // The index of the operation to jump to.
+    uint32_t target;
+};
+
+/**
+ * Runs a scan loop for the generated code.
+ *
+ * @param[in, out] state The JIT state.
+ * @param[in] step The amount to move by.
+ *
+ * @return Whether or not the loop was run.
+ */
+static bool jitScanData(struct JitState* state, const int32_t step) {
+    return scanData(state->vm, step, &state->dataIndex);
+}
+
+/**
+ * Reports a move past the end of the data array or past its memory limit, which stops the run.
+ *
+ * @param[in, out] vm The running virtual machine.
+ * @param[in] inputIndex The input index of the move.
+ * @param[in] dataIndex The data index that was moved to.
+ */
+static void jitOutOfBounds(nib_vm* vm, const uint64_t inputIndex, const size_t dataIndex) {
+    raiseError(vm, dataIndex >= vm->tape.limit ? NIB_ERROR_OUT_OF_BOUNDS : NIB_ERROR_MEMORY_LIMIT, inputIndex);
+}
+
+/**
+ * Writes a value to the output buffer for the generated code.
+ *
+ * @param[in, out] vm The running virtual machine.
+ * @param[in] value The value to write.
+ */
+static void jitWriteValue(nib_vm* vm, const uint8_t value) {
+    writeValue(vm, value);
+}
+
+/**
+ * Reads a value from the input buffer for the generated code.
+ *
+ * @param[in, out] vm The running virtual machine.
+ *
+ * @return The value that was read.
+ */
+static uint8_t jitReadValue(nib_vm* vm) {
+    return (uint8_t) readValue(vm);
+}
+
+static void emit(struct JitBuffer* buffer, const uint8_t* bytes, const size_t count) {
+    memcpy(buffer->code + buffer->size, bytes, count);
+    buffer->size += count;
+}
+
+static void emit32(struct JitBuffer* buffer, const uint32_t value) {
+    memcpy(buffer->code + buffer->size, &value, 4);
+    buffer->size += 4;
+}
+
+static void emit64(struct JitBuffer* buffer, const uint64_t value) {
+    memcpy(buffer->code + buffer->size, &value, 8);
+    buffer->size += 8;
+}
+
+static void emitCall(struct JitBuffer* buffer, const void* function) {
+    // mov rax, function
+    emit(buffer, (const uint8_t[]) { 0x48, 0xB8 }, 2);
+    emit64(buffer, (uint64_t) (uintptr_t) function);
+
+    // call rax
+    emit(buffer, (const uint8_t[]) { 0xFF, 0xD0 }, 2);
+}
+
+/**
+ * Emits the memory operand of the value at an offset from the data index ([rbx + r12 + offset]), which follows the
+ * opcode. The offset is left out when it is 0, which is shorter.
+ *
+ * @param[in] reg The register or opcode extension of the operand.
+ * @param[in] offset The offset from the data index.
+ */
+static void emitValue(struct JitBuffer* buffer, const uint8_t reg, const int32_t offset) {
+    if(offset == 0) {
+        emit(buffer, (const uint8_t[]) { (uint8_t) (0x04u | reg << 3u), 0x23 }, 2);
+    } else {
+        emit(buffer, (const uint8_t[]) { (uint8_t) (0x84u | reg << 3u), 0x23 }, 2);
+        emit32(buffer, (uint32_t) offset);
+    }
+}
+
+static void patchRelative32(struct JitBuffer* buffer, const size_t position, const size_t target) {
+    const uint32_t relative = (uint32_t) ((int64_t) target - (int64_t) (position + 4));
+    memcpy(buffer->code + position, &relative, 4);
+}
+
+/**
+ * Emits the code that writes the state back and returns from the generated code.
+ */
+static void emitReturn(struct JitBuffer* buffer) {
+    // mov [r14 + dataIndex], r12
+    emit(buffer, (const uint8_t[]) { 0x4D, 0x89, 0x66, offsetof(struct JitState, dataIndex) }, 4);
+    // mov [r14 + steps], r13
+    emit(buffer, (const uint8_t[]) { 0x4D, 0x89, 0x6E, offsetof(struct JitState, steps) }, 4);
+    // pop r15, pop r14, pop r13, pop r12, pop rbx
+    // ret
+    emit(buffer, (const uint8_t[]) { 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3 }, 10);
+}
+
+/**
+ * Emits a relative jump offset to an operation, which is resolved after all operations are generated.
+ *
+ * The fixups are freed and set to NULL if they can't grow, after which no more jumps are recorded.
+ */
+static void emitFixup(struct JitBuffer* buffer, struct JitFixup** fixups, uint32_t* fixupCount, uint32_t* fixupLimit, const uint32_t target) {
+    if(*fixups != NULL && *fixupCount == *fixupLimit) {
+        struct JitFixup* grown = (struct JitFixup*) realloc(*fixups, (size_t) *fixupLimit * 2 * sizeof(struct JitFixup));
+        if(grown == NULL)
+            free(*fixups);
+
+        *fixups = grown;
+        *fixupLimit *= 2;
+    }
+
+    if(*fixups == NULL) {
+        emit32(buffer, 0);
+        return;
+    }
+
+    (*fixups + *fixupCount)->position = buffer->size;
+    (*fixups + *fixupCount)->target = target;
+    ++(*fixupCount);
+
+    emit32(buffer, 0);
+}
+
+/**
+ * Compiles the program of a virtual machine to machine code.
+ *
+ * @param[in, out] vm The virtual machine, whose program must end with an OP_END operation.
+ *
+ * @return The generated machine code, or NULL if it could not be generated.
+ */
+static struct JitProgram* generate(nib_vm* vm) {
+    const struct Operation* program = vm->program;
+    const uint32_t programSize = vm->programSize;
+    const bool safe = vm->options.safe;
+    // The data array holds a power of two of values, so data indexes are checked by shifting out their lower bits.
+    const uint8_t limitBits = (uint8_t) __builtin_ctzll(vm->tape.limit);
+    const uint8_t reservedBits = (uint8_t) __builtin_ctzll(vm->tape.reserved);
+
+    struct JitBuffer bufferData;
+    struct JitBuffer* buffer = &bufferData;
+    const size_t capacity = (size_t) (programSize + 1) * JIT_OPERATION_SIZE + JIT_EXTRA_SIZE;
+    buffer->code = (uint8_t*) mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffer->size = 0;
+
+    if(buffer->code == MAP_FAILED)
+        return NULL;
+
+    // The code offset of each operation, used to resolve the jumps and to resume runs.
+    struct JitProgram* jit = (struct JitProgram*) malloc(sizeof(struct JitProgram));
+    uint32_t* offsets = (uint32_t*) malloc((size_t) (programSize + 1) * sizeof(uint32_t));
+    uint32_t fixupCount = 0;
+    uint32_t fixupLimit = 64;
+    struct JitFixup* fixups = (struct JitFixup*) malloc(fixupLimit * sizeof(struct JitFixup));
+
+    if(jit == NULL || offsets == NULL || fixups == NULL) {
+        free(jit);
+        free(offsets);
+        free(fixups);
+        munmap(buffer->code, capacity);
+        return NULL;
+    }
+
+    // Prologue. Five pushes keep the stack aligned to 16 bytes for the calls to C.
+    // push rbx, push r12, push r13, push r14, push r15
+    emit(buffer, (const uint8_t[]) { 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57 }, 9);
+    // mov r14, rdi
+    emit(buffer, (const uint8_t[]) { 0x49, 0x89, 0xFE }, 3);
+    // mov rbx, [r14 + data]
+    emit(buffer, (const uint8_t[]) { 0x49, 0x8B, 0x5E, offsetof(struct JitState, data) }, 4);
+    // mov r12, [r14 + dataIndex]
+    emit(buffer, (const uint8_t[]) { 0x4D, 0x8B, 0x66, offsetof(struct JitState, dataIndex) }, 4);
+    // mov r13, [r14 + steps]
+    emit(buffer, (const uint8_t[]) { 0x4D, 0x8B, 0x6E, offsetof(struct JitState, steps) }, 4);
+    // mov r15, &tape.operation
+    emit(buffer, (const uint8_t[]) { 0x49, 0xBF }, 2);
+    emit64(buffer, (uint64_t) (uintptr_t) &vm->tape.operation);
+    // jmp [r14 + entry]
+    emit(buffer, (const uint8_t[]) { 0x41, 0xFF, 0x66, offsetof(struct JitState, entry) }, 4);
+
+    for(uint32_t i = 0; i <= programSize; ++i) {
+        const struct Operation* operation = program + i;
+        *(offsets + i) = (uint32_t) buffer->size;
+
+        switch(operation->type) {
+            case OP_ADD: {
+                // add byte [rbx + r12 + offset], count
+                emit(buffer, (const uint8_t[]) { 0x42, 0x80 }, 2);
+                emitValue(buffer, 0, operation->offset);
+                emit(buffer, (const uint8_t[]) { (uint8_t) operation->count }, 1);
+                break;
+            }
+            case OP_MOVE: {
+                const uint32_t distance = operation->count < 0 ? (uint32_t) -operation->count : (uint32_t) operation->count;
+
+                if(!safe) {
+                    // mov rax, operation
+                    // mov [r15], rax
+                    emit(buffer, (const uint8_t[]) { 0x48, 0xB8 }, 2);
+                    emit64(buffer, (uint64_t) (uintptr_t) operation);
+                    emit(buffer, (const uint8_t[]) { 0x49, 0x89, 0x07 }, 3);
+                }
+
+                if(operation->count < 0) {
+                    // sub r12, distance
+                    emit(buffer, (const uint8_t[]) { 0x49, 0x81, 0xEC }, 3);
+                    emit32(buffer, distance);
+
+                    if(safe) {
+                        // Moving to a negative index is ignored, so the data index stops at 0.
+                        // jae done
+                        // xor r12d, r12d
+                        emit(buffer, (const uint8_t[]) { 0x73, 0x03, 0x45, 0x31, 0xE4 }, 5);
+                    }
+                } else {
+                    // add r12, distance
+                    emit(buffer, (const uint8_t[]) { 0x49, 0x81, 0xC4 }, 3);
+                    emit32(buffer, distance);
+
+                    if(safe) {
+                        // Only moving past the end of the data array or past its memory limit is invalid here,
+                        // which is cheaper to check than to record every move. The memory limit is never past the
+                        // end, and is only compared when there is one.
+                        if(vm->tape.memoryLimit < vm->tape.limit) {
+                            // mov rax, memoryLimit
+                            // cmp r12, rax
+                            // jb done
+                            emit(buffer, (const uint8_t[]) { 0x48, 0xB8 }, 2);
+                            emit64(buffer, vm->tape.memoryLimit);
+                            emit(buffer, (const uint8_t[]) { 0x49, 0x39, 0xC4, 0x72, 29 }, 5);
+                        } else {
+                            // mov rax, r12
+                            // shr rax, limitBits
+                            // jz done
+                            emit(buffer, (const uint8_t[]) { 0x4C, 0x89, 0xE0, 0x48, 0xC1, 0xE8, limitBits, 0x74, 29 }, 9);
+                        }
+
+                        // mov rdi, [r14 + vm]
+                        // mov rdx, r12
+                        // mov rsi, inputIndex
+                        emit(buffer, (const uint8_t[]) { 0x49, 0x8B, 0x7E, offsetof(struct JitState, vm), 0x4C, 0x89, 0xE2, 0x48, 0xBE }, 9);
+                        emit64(buffer, operation->inputIndex);
+                        emitCall(buffer, (const void*) jitOutOfBounds);
+                        // done:
+                    }
+                }
+                break;
+            }
+            case OP_WRITE: {
+                // mov rdi, [r14 + vm]
+                // movzx esi, byte [rbx + r12 + offset]
+                emit(buffer, (const uint8_t[]) { 0x49, 0x8B, 0x7E, offsetof(struct JitState, vm), 0x42, 0x0F, 0xB6 }, 7);
+                emitValue(buffer, 6, operation->offset);
+                emitCall(buffer, (const void*) jitWriteValue);
+                break;
+            }
+            case OP_READ: {
+                // mov rdi, [r14 + vm]
+                emit(buffer, (const uint8_t[]) { 0x49, 0x8B, 0x7E, offsetof(struct JitState, vm) }, 4);
+                emitCall(buffer, (const void*) jitReadValue);
+                // mov byte [rbx + r12 + offset], al
+                emit(buffer, (const uint8_t[]) { 0x42, 0x88 }, 2);
+                emitValue(buffer, 0, operation->offset);
+                break;
+            }
+            case OP_LOOP_START: {
+                // Both ends of the loop jump right after each other.
+                // cmp byte [rbx + r12], 0
+                // je end + 1
+                emit(buffer, (const uint8_t[]) { 0x42, 0x80, 0x3C, 0x23, 0x00, 0x0F, 0x84 }, 7);
+                emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, operation->jump + 1);
+                break;
+            }
+            case OP_LOOP_END: {
+                // cmp byte [rbx + r12], 0
+                // je done
+                // sub r13, count
+                // jae start + 1
+                emit(buffer, (const uint8_t[]) { 0x42, 0x80, 0x3C, 0x23, 0x00, 0x74, 46, 0x49, 0x81, 0xED }, 10);
+                emit32(buffer, (uint32_t) operation->count);
+                emit(buffer, (const uint8_t[]) { 0x0F, 0x83 }, 2);
+                emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, operation->jump + 1);
+
+                // There are not enough steps left, so stop before repeating the loop and resume from here.
+                // add r13, count
+                emit(buffer, (const uint8_t[]) { 0x49, 0x81, 0xC5 }, 3);
+                emit32(buffer, (uint32_t) operation->count);
+                // mov dword [r14 + programIndex], i
+                emit(buffer, (const uint8_t[]) { 0x41, 0xC7, 0x46, offsetof(struct JitState, programIndex) }, 4);
+                emit32(buffer, i);
+                emitReturn(buffer);
+                // done:
+                break;
+            }
+            case OP_CLEAR: {
+                // mov byte [rbx + r12 + offset], 0
+                emit(buffer, (const uint8_t[]) { 0x42, 0xC6 }, 2);
+                emitValue(buffer, 0, operation->offset);
+                emit(buffer, (const uint8_t[]) { 0x00 }, 1);
+                break;
+            }
+            case OP_MULTIPLY: {
+                // The same checks as multiplyData(), which fall back to the original loop right after the
+                // multiplications when they fail.
+                const uint32_t loop = i + operation->count + 1;
+                const struct Operation* last = operation + operation->count;
+
+                // mov rax, r12
+                // shr rax, reservedBits
+                // jnz loop
+                emit(buffer, (const uint8_t[]) { 0x4C, 0x89, 0xE0, 0x48, 0xC1, 0xE8, reservedBits, 0x0F, 0x85 }, 9);
+                emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, loop);
+                // movzx eax, byte [rbx + r12]
+                // test eax, eax
+                // je end + 1
+                emit(buffer, (const uint8_t[]) { 0x42, 0x0F, 0xB6, 0x04, 0x23, 0x85, 0xC0, 0x0F, 0x84 }, 9);
+                emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, operation->jump + 1);
+
+                if(operation->offset < 0) {
+                    // mov ecx, -offset
+                    // cmp r12, rcx
+                    // jb loop
+                    emit(buffer, (const uint8_t[]) { 0xB9 }, 1);
+                    emit32(buffer, (uint32_t) -(int64_t) operation->offset);
+                    emit(buffer, (const uint8_t[]) { 0x49, 0x39, 0xCC, 0x0F, 0x82 }, 5);
+                    emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, loop);
+                }
+
+                if(operation->count > 0 && last->offset > 0) {
+                    // lea rcx, [r12 + offset]
+                    emit(buffer, (const uint8_t[]) { 0x49, 0x8D, 0x8C, 0x24 }, 4);
+                    emit32(buffer, (uint32_t) last->offset);
+                    // shr rcx, reservedBits
+                    // jnz loop
+                    emit(buffer, (const uint8_t[]) { 0x48, 0xC1, 0xE9, reservedBits, 0x0F, 0x85 }, 6);
+                    emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, loop);
+                }
+
+                for(const struct Operation* multiply = operation + 1; multiply <= last; ++multiply) {
+                    // imul edx, eax, count
+                    emit(buffer, (const uint8_t[]) { 0x69, 0xD0 }, 2);
+                    emit32(buffer, (uint32_t) multiply->count);
+                    // add byte [rbx + r12 + offset], dl
+                    emit(buffer, (const uint8_t[]) { 0x42, 0x00, 0x94, 0x23 }, 4);
+                    emit32(buffer, (uint32_t) multiply->offset);
+                }
+
+                // mov byte [rbx + r12], 0
+                // jmp end + 1
+                emit(buffer, (const uint8_t[]) { 0x42, 0xC6, 0x04, 0x23, 0x00, 0xE9 }, 6);
+                emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, operation->jump + 1);
+                break;
+            }
+            case OP_SCAN: {
+                // mov [r14 + dataIndex], r12
+                emit(buffer, (const uint8_t[]) { 0x4D, 0x89, 0x66, offsetof(struct JitState, dataIndex) }, 4);
+                // mov rdi, r14
+                // mov esi, count
+                emit(buffer, (const uint8_t[]) { 0x4C, 0x89, 0xF7, 0xBE }, 4);
+                emit32(buffer, (uint32_t) operation->count);
+                emitCall(buffer, (const void*) jitScanData);
+                // mov r12, [r14 + dataIndex]
+                emit(buffer, (const uint8_t[]) { 0x4D, 0x8B, 0x66, offsetof(struct JitState, dataIndex) }, 4);
+                // test al, al
+                // jne end + 1
+                emit(buffer, (const uint8_t[]) { 0x84, 0xC0, 0x0F, 0x85 }, 4);
+                emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, operation->jump + 1);
+                break;
+            }
+            case OP_RANGE: {
+                // The same checks as checkRange(), which fall back to the original loop right after this operation
+                // when they fail. Otherwise, the copy after the original loop is run.
+                // mov rax, r12
+                // shr rax, reservedBits
+                // jnz loop
+                emit(buffer, (const uint8_t[]) { 0x4C, 0x89, 0xE0, 0x48, 0xC1, 0xE8, reservedBits, 0x0F, 0x85 }, 9);
+                emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, i + 1);
+
+                if(operation->offset < 0) {
+                    // mov ecx, -offset
+                    // cmp r12, rcx
+                    // jb loop
+                    emit(buffer, (const uint8_t[]) { 0xB9 }, 1);
+                    emit32(buffer, (uint32_t) -(int64_t) operation->offset);
+                    emit(buffer, (const uint8_t[]) { 0x49, 0x39, 0xCC, 0x0F, 0x82 }, 5);
+                    emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, i + 1);
+                }
+
+                if(operation->count > 0) {
+                    // lea rcx, [r12 + count]
+                    emit(buffer, (const uint8_t[]) { 0x49, 0x8D, 0x8C, 0x24 }, 4);
+                    emit32(buffer, (uint32_t) operation->count);
+                    // shr rcx, reservedBits
+                    // jnz loop
+                    emit(buffer, (const uint8_t[]) { 0x48, 0xC1, 0xE9, reservedBits, 0x0F, 0x85 }, 6);
+                    emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, i + 1);
+                }
+
+                // jmp end + 1
+                emit(buffer, (const uint8_t[]) { 0xE9 }, 1);
+                emitFixup(buffer, &fixups, &fixupCount, &fixupLimit, operation->jump + 1);
+                break;
+            }
+            case OP_END: {
+                // mov dword [r14 + programIndex], programSize
+                emit(buffer, (const uint8_t[]) { 0x41, 0xC7, 0x46, offsetof(struct JitState, programIndex) }, 4);
+                emit32(buffer, programSize);
+                emitReturn(buffer);
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+
+    // The jumps can't be resolved without all of the fixups, so the caller falls back to an interpreter.
+    if(fixups == NULL) {
+        munmap(buffer->code, capacity);
+        free(offsets);
+        free(jit);
+        return NULL;
+    }
+
+    for(uint32_t i = 0; i < fixupCount; ++i)
+        patchRelative32(buffer, (fixups + i)->position, *(offsets + (fixups + i)->target));
+
+    free(fixups);
+
+    // The code is never writable and executable at the same time.
+    if(mprotect(buffer->code, capacity, PROT_READ | PROT_EXEC) != 0) {
+        munmap(buffer->code, capacity);
+        free(offsets);
+        free(jit);
+        return NULL;
+    }
+
+    jit->code = buffer->code;
+    jit->size = capacity;
+    jit->offsets = offsets;
+    return jit;
+}
+
+bool interpretJit(nib_vm* vm) {
+    // The code is generated once, and reused by every run until another program is loaded.
+    if(vm->jit == NULL && (vm->jit = generate(vm)) == NULL)
+        return false;
+
+    const struct JitProgram* jit = vm->jit;
+    struct JitState state = { vm->tape.cells, vm->steps, jit->code + *(jit->offsets + vm->programIndex), vm, vm->dataIndex, vm->programIndex };
+    void (*function)(struct JitState*);
+
+    // Converting a data pointer to a function pointer is not allowed by ISO C, but it is by POSIX.
+    *(void**) &function = jit->code;
+    function(&state);
+
+    vm->programIndex = state.programIndex;
+    vm->dataIndex = state.dataIndex;
+    vm->steps = state.steps;
+    return true;
+}
+
+void freeJit(nib_vm* vm) {
+    if(vm->jit == NULL)
+        return;
+
+    munmap(vm->jit->code, vm->jit->size);
+    free(vm->jit->offsets);
+    free(vm->jit);
+    vm->jit = NULL;
+}
+
+#else
+
+bool interpretJit(nib_vm* vm) {
+    // There is no JIT for this platform, so the caller must fall back to an interpreter.
+    (void) vm;
+    return false;
+}
+
+void freeJit(nib_vm* vm) {
+    // Nothing is ever generated.
+    (void) vm;
+}
+
+#endif
@@ -0,0 +1,371 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LIBNIB_H
+#define LIBNIB_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// The public interface of the NIB library, which compiles and runs scripts inside virtual machines. Virtual
+// machines don't share any state, so a process can host many of them at once, even on different threads, as long
+// as each one is only used by one thread at a time.
+
+/**
+ * Represents a virtual machine, which holds a compiled script, its data array and its I/O buffers.
+ */
+typedef struct nib_vm nib_vm;
+
+/**
+ * Represents a type of interpreter.
+ */
+enum NIB_ENGINE { NIB_ENGINE_CLASSIC, NIB_ENGINE_THREADED, NIB_ENGINE_JIT };
+
+/**
+ * Represents the result of loading or running a script.
+ */
+enum NIB_STATUS {
+    // The script was loaded, or it was run until its end.
+    NIB_OK,
+    // The script was run for the maximum amount of steps, and running it again resumes it.
+    NIB_STEP_LIMIT,
+    // The script was run for the maximum amount of time, and running it again resumes it.
+    NIB_TIMEOUT,
+    // The run was cancelled by nibCancel(), and running it again resumes it.
+    NIB_CANCELLED,
+    // No script was loaded.
+    NIB_ERROR_NO_SCRIPT,
+    // The script is too large to be loaded.
+    NIB_ERROR_TOO_LARGE,
+    // A loop end has no matching loop start.
+    NIB_ERROR_UNEXPECTED_LOOP_END,
+    // A loop start has no matching loop end.
+    NIB_ERROR_EXPECTED_LOOP_END,
+    // The data index went out of bounds.
+    NIB_ERROR_OUT_OF_BOUNDS,
+    // Memory could not be allocated.
+    NIB_ERROR_MEMORY,
+    // The data array would use more memory than its limit.
+    NIB_ERROR_MEMORY_LIMIT,
+    // The output could not be written.
+    NIB_ERROR_OUTPUT
+};
+
+/**
+ * Represents the options of a virtual machine.
+ */
+struct NibOptions {
+    // The amount of extra memory to allocate for the data array when it runs out of it, in bytes.
+    uint32_t memStepSize;
+    // Whether or not to use the safe interpreter.
+    bool safe;
+    // The type of interpreter to use.
+    enum NIB_ENGINE engine;
+    // Whether or not scripts are compiled straight from the packed input, without decoding them first.
+    bool packed;
+    // The size of the output and input buffers, in bytes.
+    uint32_t bufferSize;
+    // Whether or not to flush the output after every line.
+    bool lineBuffered;
+    // Whether or not to count every operation that is run, which uses the threaded interpreter no matter the engine.
+    bool profile;
+    // Whether or not the data array is split into fixed-size pages that are allocated when they are first used, so
+    // that only the values that are used take memory. This uses the threaded interpreter no matter the engine.
+    bool paged;
+    // The maximum amount of memory that the data array can use, in bytes, or 0 for no limit. With guard pages, it's
+    // rounded up to whole pages of the system. The paged data array counts the pages that it allocated, and always has
+    // at least one.
+    uint64_t maxMemory;
+    // The size of the region that is reserved for the data array with guard pages, in bytes. It's rounded up to a
+    // power of two, and is at most 64 GiB unless NIB_TAPE_BITS was defined when building. Data indexes past it are
+    // out of bounds. With a memory limit, only enough for the limit is reserved. Without guard pages, and for the
+    // paged data array, it's ignored.
+    uint64_t reservedMemory;
+    // The maximum amount of time that every run can take, in milliseconds, or 0 for no limit.
+    uint32_t timeLimit;
+    // The width of the values of the data array, either 8, 16 or 32 bits. Values wrap around at their width, and only
+    // their lowest 8 bits are written. Wider values use the threaded interpreter no matter the engine.
+    uint32_t cellBits;
+    // The maximum amount of steps to run when a script is loaded, up to its first read, so that every run of the
+    // script starts from where they stopped instead of from its start. 0 to not precompute anything. The profiler
+    // always runs the whole script.
+    uint64_t precomputeSteps;
+    // The amount of threads that decode and compile a script when it is loaded, including the calling one. Large
+    // scripts are split into chunks that are compiled at once, which gives the same program as compiling them whole.
+    uint32_t loadThreads;
+};
+
+/**
+ * Represents the output and input of a virtual machine.
+ */
+struct NibIo {
+    /**
+     * Writes bytes to the output.
+     *
+     * @param[in] context The context of the I/O.
+     * @param[in] bytes The bytes to write.
+     * @param[in] size The amount of bytes to write.
+     *
+     * @return Whether or not all bytes were written. If not, the run fails with NIB_ERROR_OUTPUT.
+     */
+    bool (*write)(void* context, const uint8_t* bytes, size_t size);
+    /**
+     * Reads bytes from the input, returning as soon as some are available.
+     *
+     * @param[in] context The context of the I/O.
+     * @param[out] bytes The bytes that were read.
+     * @param[in] size The maximum amount of bytes to read.
+     *
+     * @return The amount of bytes that were read, or 0 if the input has ended.
+     */
+    size_t (*read)(void* context, uint8_t* bytes, size_t size);
+    // The context that is passed to both functions.
+    void* context;
+};
+
+/**
+ * Represents the amount of loops that were replaced with faster operations when compiling.
+ */
+struct IdiomStatistics {
+    uint32_t clearLoops;
+    uint32_t multiplyLoops;
+    uint32_t scanLoops;
+    // Balanced loops are copied without their moves instead, and the original loop is kept.
+    uint32_t balancedLoops;
+};
+
+/**
+ * Represents what the profiler counted since a virtual machine was last reset.
+ */
+struct NibProfile {
+    // The amount of operations that were run.
+    uint64_t operations;
+    // The amount of steps that were taken.
+    uint64_t steps;
+    // The highest data index that was moved to.
+    uint64_t maxDataIndex;
+    // The time spent writing the output and reading the input, in seconds.
+    double ioSeconds;
+};
+
+/**
+ * Represents what the profiler counted for a loop.
+ */
+struct NibLoopProfile {
+    // The input index of the loop start.
+    uint64_t inputIndex;
+    // The amount of times that the body of the loop was run.
+    uint64_t iterations;
+    // The amount of operations that were run inside the loop, including the ones of the loops inside it.
+    uint64_t operations;
+};
+
+/**
+ * Represents what was precomputed when the script of a virtual machine was loaded.
+ */
+struct NibSnapshot {
+    // The amount of steps that were taken.
+    uint64_t steps;
+    // The amount of output bytes that were written, which the first run writes at once.
+    uint64_t outputSize;
+    // The input index of the operation that runs start from.
+    uint64_t inputIndex;
+};
+
+/**
+ * Gets the default options of a virtual machine.
+ *
+ * @param[out] options The default options.
+ */
+void nibDefaultOptions(struct NibOptions* options);
+/**
+ * Creates a virtual machine.
+ *
+ * @param[in] options The options of the virtual machine.
+ * @param[in] io The output and input of the virtual machine, or NULL to use STDOUT and STDIN.
+ *
+ * @return The virtual machine, or NULL if its memory could not be allocated or if the width of its values is invalid.
+ */
+nib_vm* nibCreate(const struct NibOptions* options, const struct NibIo* io);
+/**
+ * Compiles a script and loads it in a virtual machine, replacing the previous one and resetting the virtual machine.
+ *
+ * If the options of the virtual machine have precomputed steps, the script is then run without any input for up to
+ * that many steps, and stops before it first reads. The data array, the output and the operation that it reached are
+ * kept, so that every run starts from there and only writes that output. The precomputed steps don't count towards
+ * the maximum amount of steps of the runs.
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in] source The encoded script, with two nibbles in each byte.
+ * @param[in] size The size of the script, in bytes.
+ *
+ * @return NIB_OK, or the reason why the script could not be loaded. nibErrorIndex() gives the input index of
+ * unbalanced loops.
+ */
+enum NIB_STATUS nibLoad(nib_vm* vm, const uint8_t* source, size_t size);
+/**
+ * Loads a script like nibLoad(), but takes the compiled script from a cache file if it was compiled from the same
+ * script before.
+ *
+ * The cache file holds the compiled operations, along with the hash and the size of the script and the version of
+ * the cache format. It is mapped in memory where possible, so the script is neither decoded nor compiled again.
+ * When the cache file is missing or doesn't match, the script is compiled and the cache file is replaced. Scripts
+ * that are rejected are not cached. What was precomputed is cached as well, and is only used with the same
+ * precomputed steps, width of the values and memory limit.
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in] source The encoded script, with two nibbles in each byte.
+ * @param[in] size The size of the script, in bytes.
+ * @param[in] path The path of the cache file.
+ *
+ * @return NIB_OK, or the reason why the script could not be loaded.
+ */
+enum NIB_STATUS nibLoadCached(nib_vm* vm, const uint8_t* source, size_t size, const char* path);
+/**
+ * Runs the script of a virtual machine, from where the last run stopped.
+ *
+ * Every repetition of a loop counts as one step for each operation in the loop, and the script is stopped when a
+ * loop would repeat past the maximum amount of steps. Runs take at least as many steps as one repetition of the
+ * largest loop, so that they always make progress. The output is flushed before returning.
+ *
+ * The steps are run in slices, and the time limit and nibCancel() are only checked between them, so the run stops
+ * at a loop end a few milliseconds later. Time spent waiting for the input only counts once it's read.
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in] maxSteps The maximum amount of steps to run for, or 0 to run until the end of the script.
+ *
+ * @return NIB_OK if the script ended, NIB_STEP_LIMIT, NIB_TIMEOUT or NIB_CANCELLED if it can be resumed, or the
+ * reason why it failed. nibErrorIndex() gives the input index of out of bounds accesses, of accesses past the memory
+ * limit, and of the operation that a resumable run stopped at. After a failure, the same error is returned until
+ * the virtual machine is reset.
+ */
+enum NIB_STATUS nibRun(nib_vm* vm, uint64_t maxSteps);
+/**
+ * Reads a script in chunks and runs it while it's being read, replacing the previous script and resetting the
+ * virtual machine first.
+ *
+ * Every chunk is decoded and compiled as soon as it's read, up to the oldest loop that is still open, and run on the
+ * same data array as the chunks before it. Only the script from that loop on is kept, so scripts that are mostly
+ * linear start running right away and never need to be read whole. The limits apply to the whole script, and the
+ * profiler is not used. Unlike nibRun(), a step limit isn't raised to the size of the largest loop, and an invalid
+ * script is only caught once the invalid part is read, after everything before it has run.
+ *
+ * Afterwards, the virtual machine has no script, so a run that was stopped can't be resumed.
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in] read The function that reads the encoded script, with two nibbles in each byte. It returns the amount
+ * of bytes that were read, as soon as some are available, or 0 if the script has ended.
+ * @param[in] context The context that is passed to the read function.
+ * @param[in] maxSteps The maximum amount of steps to run for, or 0 to run until the end of the script.
+ *
+ * @return NIB_OK if the script ended, NIB_STEP_LIMIT, NIB_TIMEOUT or NIB_CANCELLED if it was stopped, or the reason
+ * why it could not be loaded or run. nibErrorIndex() gives the input index of the error inside the whole script.
+ */
+enum NIB_STATUS nibRunStream(nib_vm* vm, size_t (*read)(void* context, uint8_t* bytes, size_t size), void* context, uint64_t maxSteps);
+/**
+ * Cancels the current run of a virtual machine, or the next one if it's not running.
+ *
+ * Unlike the other functions, this can be called from any thread, even while another thread runs the virtual
+ * machine, and from signal handlers where atomic flags are lock-free.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void nibCancel(nib_vm* vm);
+/**
+ * Resets a virtual machine, so that its script runs again from the start with an empty data array.
+ *
+ * The memory of the data array and of the buffers is kept, and the unread input is dropped. A pending
+ * cancellation is dropped as well.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void nibReset(nib_vm* vm);
+/**
+ * Destroys a virtual machine and frees its memory.
+ *
+ * @param[in, out] vm The virtual machine, or NULL.
+ */
+void nibDestroy(nib_vm* vm);
+/**
+ * Transpiles the script of a virtual machine to C, as a standalone program that reads STDIN and writes STDOUT
+ * exactly like the interpreter.
+ *
+ * The safe option, the memory step size, the buffer size and the line buffering of the virtual machine are kept.
+ * Runs of instructions are folded and common loops are replaced just like when interpreting, and the unsafe program
+ * also keeps the moves of the data index as offsets until the next loop.
+ *
+ * @param[in] vm The virtual machine, which has a script.
+ * @param[in, out] output The file to write the C source to.
+ *
+ * @return Whether or not the C source was written.
+ */
+bool nibEmitC(const nib_vm* vm, FILE* output);
+/**
+ * Gets the input index of the last error of a virtual machine.
+ *
+ * @param[in] vm The virtual machine.
+ *
+ * @return The index of the decoded nibble that caused the error, or that the last resumable run stopped at.
+ */
+uint64_t nibErrorIndex(const nib_vm* vm);
+/**
+ * Gets the amount of loops that were replaced with faster operations when loading the script of a virtual machine.
+ *
+ * @param[in] vm The virtual machine.
+ *
+ * @return The idiom statistics.
+ */
+const struct IdiomStatistics* nibStatistics(const nib_vm* vm);
+/**
+ * Gets what was precomputed when the script of a virtual machine was loaded.
+ *
+ * @param[in] vm The virtual machine.
+ * @param[out] snapshot What was precomputed.
+ *
+ * @return Whether or not anything was precomputed.
+ */
+bool nibGetSnapshot(const nib_vm* vm, struct NibSnapshot* snapshot);
+/**
+ * Gets what the profiler counted since a virtual machine was last reset.
+ *
+ * @param[in] vm The virtual machine.
+ * @param[out] profile The profile.
+ *
+ * @return Whether or not the virtual machine was created with the profiler and has a script.
+ */
+bool nibGetProfile(const nib_vm* vm, struct NibProfile* profile);
+/**
+ * Gets the loops in which the most operations were run since a virtual machine was last reset.
+ *
+ * Loops that were replaced with faster operations are not included, unless the original loop had to be run.
+ *
+ * @param[in] vm The virtual machine.
+ * @param[out] loops The hottest loops, sorted by the amount of operations that were run inside them.
+ * @param[in] count The maximum amount of loops to get.
+ *
+ * @return The amount of loops that were written, which is 0 if the virtual machine has no profile.
+ */
+uint32_t nibGetHotLoops(const nib_vm* vm, struct NibLoopProfile* loops, uint32_t count);
+
+#endif
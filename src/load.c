@@ -0,0 +1,361 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nib.h"
+
+// Chunks are compiled on several threads when the platform supports them, and on the calling thread otherwise.
+#if defined(__unix__) || defined(__APPLE__)
+#define NIB_POSIX_THREADS
+#include <pthread.h>
+#include <stdatomic.h>
+#elif defined(_WIN32)
+#define NIB_WINDOWS_THREADS
+#include <windows.h>
+#endif
+
+// The amount of chunks for every thread, so that the threads which finish early take the chunks of the others.
+#define CHUNKS_PER_THREAD 4u
+// The amount of bytes after the planned start of a chunk in which a loop is searched for it to start with.
+#define SPLIT_SEARCH_LIMIT ((size_t) 1 << 16)
+
+/**
+ * Represents a script that is being loaded on several threads.
+ */
+struct Load {
+    // The packed script, and the buffer that it's decoded to, or NULL if the chunks are compiled from the script.
+    const uint8_t* source;
+    uint8_t* decoded;
+    struct Chunk* chunks;
+    uint32_t chunkCount;
+    // The program that the chunks are moved into, and their indexes in it, or NULL while they are compiled.
+    struct Operation* program;
+    uint32_t* offsets;
+    // The index of the next chunk to compile or move.
+#if defined(NIB_POSIX_THREADS)
+    atomic_uint nextChunk;
+#elif defined(NIB_WINDOWS_THREADS)
+    volatile LONG nextChunk;
+#else
+    uint32_t nextChunk;
+#endif
+};
+
+/**
+ * Gets a nibble from a packed script.
+ *
+ * @param[in] source The script.
+ * @param[in] index The index of the nibble.
+ *
+ * @return The nibble.
+ */
+static inline uint8_t getNibble(const uint8_t* source, const size_t index) {
+    // The left nibble comes first.
+    const uint8_t current = *(source + index / 2);
+    return (index & 1u) ? current & RIGHT_MASK : (current & LEFT_MASK) >> 4u;
+}
+
+/**
+ * Checks whether or not two instructions that follow each other must be compiled in the same chunk. They must if
+ * they are folded into a single operation, or if they are both moves, as the compiler limits how far moves that
+ * follow each other go in total.
+ *
+ * @param[in] first The first instruction.
+ * @param[in] second The second instruction.
+ *
+ * @return Whether or not they must be compiled together.
+ */
+static bool joined(const uint8_t first, const uint8_t second) {
+    const bool firstAdds = first == NIB_INCREMENT_VALUE || first == NIB_DECREMENT_VALUE;
+    const bool secondAdds = second == NIB_INCREMENT_VALUE || second == NIB_DECREMENT_VALUE;
+    const bool firstMoves = first == NIB_INCREMENT_POINTER || first == NIB_DECREMENT_POINTER;
+    const bool secondMoves = second == NIB_INCREMENT_POINTER || second == NIB_DECREMENT_POINTER;
+
+    return (firstAdds && secondAdds) || (firstMoves && secondMoves);
+}
+
+/**
+ * Checks whether or not a chunk can start at a byte of a script, which it can unless it's between two instructions
+ * that must be compiled together.
+ *
+ * @param[in] source The packed script.
+ * @param[in] sourceSize The size of the script, in bytes.
+ * @param[in] index The index of the byte.
+ *
+ * @return Whether or not a chunk can start there.
+ */
+static bool canSplit(const uint8_t* source, const size_t sourceSize, const size_t index) {
+    // Runs are folded across padding nibbles.
+    size_t before = index * 2;
+    while(before > 0 && (getNibble(source, before - 1) & NIB_PADDING_BIT))
+        --before;
+
+    size_t after = index * 2;
+    while(after < sourceSize * 2 && (getNibble(source, after) & NIB_PADDING_BIT))
+        ++after;
+
+    return before == 0 || after == sourceSize * 2 || !joined(getNibble(source, before - 1), getNibble(source, after));
+}
+
+/**
+ * Checks whether or not a chunk can start at a byte of a script with a loop that is not replaced with an OP_CLEAR
+ * operation. The loops that cross the start of such a chunk contain another loop, so they are never replaced.
+ *
+ * @param[in] source The packed script.
+ * @param[in] sourceSize The size of the script, in bytes.
+ * @param[in] index The index of the byte.
+ *
+ * @return Whether or not a chunk can start there with such a loop.
+ */
+static bool startsLoop(const uint8_t* source, const size_t sourceSize, const size_t index) {
+    size_t next = index * 2;
+    while(next < sourceSize * 2 && (getNibble(source, next) & NIB_PADDING_BIT))
+        ++next;
+
+    if(next == sourceSize * 2 || getNibble(source, next) != NIB_LOOP_START)
+        return false;
+
+    // Only loops that start by changing the value can be replaced with an OP_CLEAR operation.
+    for(++next; next < sourceSize * 2 && (getNibble(source, next) & NIB_PADDING_BIT); ++next);
+
+    return next < sourceSize * 2 && getNibble(source, next) != NIB_INCREMENT_VALUE && getNibble(source, next) != NIB_DECREMENT_VALUE;
+}
+
+/**
+ * Takes the next chunk of a script.
+ *
+ * @param[in, out] load The script.
+ *
+ * @return The index of the chunk, or a value past the last chunk if there are none left.
+ */
+static uint32_t takeChunk(struct Load* load) {
+#if defined(NIB_POSIX_THREADS)
+    return (uint32_t) atomic_fetch_add_explicit(&load->nextChunk, 1, memory_order_relaxed);
+#elif defined(NIB_WINDOWS_THREADS)
+    return (uint32_t) InterlockedIncrement(&load->nextChunk) - 1;
+#else
+    return load->nextChunk++;
+#endif
+}
+
+/**
+ * Decodes and compiles the chunks of a script, or moves them into the program, until there are none left.
+ *
+ * @param[in, out] load The script.
+ */
+static void runLoadWorker(struct Load* load) {
+    for(uint32_t index = takeChunk(load); index < load->chunkCount; index = takeChunk(load)) {
+        struct Chunk* chunk = load->chunks + index;
+
+        // The chunk is freed as soon as it's moved, so that less memory is used at once.
+        if(load->program != NULL) {
+            const uint32_t offset = *(load->offsets + index);
+
+            moveOperations(load->program + offset, chunk->program, chunk->size, offset);
+            free(chunk->program);
+            chunk->program = NULL;
+            continue;
+        }
+
+        // Chunks start and end at whole bytes, so each one is decoded on its own.
+        if(load->decoded != NULL) {
+            decodeInto(load->source + chunk->start / 2, (chunk->end - chunk->start) / 2, load->decoded + chunk->start);
+            chunk->status = compileChunk(load->decoded, false, chunk);
+        } else chunk->status = compileChunk(load->source, true, chunk);
+    }
+}
+
+#if defined(NIB_POSIX_THREADS)
+static void* startLoadWorker(void* load) {
+    runLoadWorker((struct Load*) load);
+    return NULL;
+}
+#elif defined(NIB_WINDOWS_THREADS)
+static DWORD WINAPI startLoadWorker(LPVOID load) {
+    runLoadWorker((struct Load*) load);
+    return 0;
+}
+#endif
+
+/**
+ * Runs a worker on several threads until there are no chunks left.
+ *
+ * @param[in, out] load The script.
+ * @param[in] workerCount The amount of workers, including the calling thread.
+ */
+static void runWorkers(struct Load* load, const uint32_t workerCount) {
+    load->nextChunk = 0;
+
+#if defined(NIB_POSIX_THREADS)
+    pthread_t* threads = (pthread_t*) malloc(workerCount * sizeof(pthread_t));
+    uint32_t startedCount = 1;
+
+    for(; threads != NULL && startedCount < workerCount; ++startedCount) {
+        if(pthread_create(threads + startedCount, NULL, startLoadWorker, load) != 0)
+            break;
+    }
+#elif defined(NIB_WINDOWS_THREADS)
+    HANDLE* threads = (HANDLE*) malloc(workerCount * sizeof(HANDLE));
+    uint32_t startedCount = 1;
+
+    for(; threads != NULL && startedCount < workerCount; ++startedCount) {
+        *(threads + startedCount) = CreateThread(NULL, 0, startLoadWorker, load, 0, NULL);
+        if(*(threads + startedCount) == NULL)
+            break;
+    }
+#else
+    (void) workerCount;
+#endif
+
+    // The calling thread is the first worker, and takes every chunk if no threads were started.
+    runLoadWorker(load);
+
+#if defined(NIB_POSIX_THREADS)
+    for(uint32_t i = 1; i < startedCount; ++i)
+        pthread_join(*(threads + i), NULL);
+    free(threads);
+#elif defined(NIB_WINDOWS_THREADS)
+    for(uint32_t i = 1; i < startedCount; ++i) {
+        WaitForSingleObject(*(threads + i), INFINITE);
+        CloseHandle(*(threads + i));
+    }
+    free(threads);
+#endif
+}
+
+/**
+ * Moves compiled chunks into a whole program at once on several threads, if none of the loops between them would
+ * be replaced.
+ *
+ * @param[in, out] load The script.
+ * @param[in] workerCount The amount of workers, including the calling thread.
+ * @param[in, out] result The program. A previous array is reused.
+ *
+ * @return Whether or not the chunks were moved. They are merged by mergeChunks() otherwise.
+ */
+static bool moveChunks(struct Load* load, const uint32_t workerCount, struct Operation** result) {
+    uint64_t size = 0;
+
+    for(uint32_t i = 0; i < load->chunkCount; ++i) {
+        const struct Chunk* chunk = load->chunks + i;
+        if(chunk->status != NIB_OK)
+            return false;
+
+        if(i > 0) {
+            if(chunk->size == 0)
+                return false;
+
+            switch(chunk->program->type) {
+                case OP_LOOP_START:
+                case OP_MULTIPLY:
+                case OP_SCAN:
+                case OP_RANGE:
+                    break;
+                default:
+                    return false;
+            }
+        }
+        size += chunk->size;
+    }
+    if(size > NIB_PROGRAM_LIMIT)
+        return false;
+
+    load->offsets = (uint32_t*) malloc(load->chunkCount * sizeof(uint32_t));
+    struct Operation* program = (struct Operation*) realloc(*result, (size_t) (size + 1) * sizeof(struct Operation));
+    if(load->offsets == NULL || program == NULL) {
+        free(load->offsets);
+        return false;
+    }
+    *result = program;
+
+    uint32_t offset = 0;
+    for(uint32_t i = 0; i < load->chunkCount; ++i) {
+        *(load->offsets + i) = offset;
+        offset += (load->chunks + i)->size;
+    }
+
+    load->program = program;
+    runWorkers(load, workerCount);
+    free(load->offsets);
+    return true;
+}
+
+enum NIB_STATUS compileParallel(const uint8_t* source, const size_t sourceSize, const bool packed, const uint32_t threadCount, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex) {
+    uint64_t chunkLimit = sourceSize / NIB_CHUNK_SIZE;
+    if(chunkLimit > (uint64_t) threadCount * CHUNKS_PER_THREAD)
+        chunkLimit = (uint64_t) threadCount * CHUNKS_PER_THREAD;
+    if(chunkLimit == 0)
+        chunkLimit = 1;
+
+    struct Load load;
+    load.source = source;
+    load.decoded = packed ? NULL : (uint8_t*) malloc(sourceSize > 0 ? sourceSize * 2 : 1);
+    load.chunks = (struct Chunk*) calloc((size_t) chunkLimit, sizeof(struct Chunk));
+    load.chunkCount = 0;
+    load.program = NULL;
+    load.offsets = NULL;
+
+    if((!packed && load.decoded == NULL) || load.chunks == NULL) {
+        free(load.decoded);
+        free(load.chunks);
+        freeAll(OPERATION, 1, result);
+        return NIB_ERROR_MEMORY;
+    }
+
+    // Split the script into chunks of about the same size. Each chunk starts at a loop after the planned start if
+    // there is one nearby, and otherwise at the first byte that doesn't split a run of moves or of additions. Chunks
+    // that would be empty are left out.
+    size_t start = 0;
+    for(uint64_t i = 1; i <= chunkLimit && start < sourceSize; ++i) {
+        size_t end = i == chunkLimit ? sourceSize : (size_t) (sourceSize / chunkLimit * i);
+        if(end <= start)
+            continue;
+
+        const size_t searchEnd = sourceSize - end > SPLIT_SEARCH_LIMIT ? end + SPLIT_SEARCH_LIMIT : sourceSize;
+        size_t loopStart = end;
+        while(loopStart < searchEnd && !startsLoop(source, sourceSize, loopStart))
+            ++loopStart;
+
+        if(loopStart < searchEnd)
+            end = loopStart;
+        else {
+            while(end < sourceSize && !canSplit(source, sourceSize, end))
+                ++end;
+        }
+
+        struct Chunk* chunk = load.chunks + load.chunkCount++;
+        chunk->start = start * 2;
+        chunk->end = end * 2;
+        start = end;
+    }
+
+    const uint32_t workerCount = threadCount < load.chunkCount ? threadCount : load.chunkCount;
+    runWorkers(&load, workerCount);
+    free(load.decoded);
+
+    enum NIB_STATUS status;
+    if(moveChunks(&load, workerCount, result))
+        status = linkChunks(load.chunks, load.chunkCount, sourceSize * 2, result, resultSize, statistics, errorIndex);
+    else status = mergeChunks(load.chunks, load.chunkCount, sourceSize * 2, result, resultSize, statistics, errorIndex);
+
+    free(load.chunks);
+    return status;
+}
@@ -20,10 +20,869 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include "nib.h"
+// Needed for fileno(), isatty(), mmap(), sysconf() and fseeko() when compiling in strict C11 mode.
+#define _DEFAULT_SOURCE
+// Files larger than 2 GB need 64-bit offsets on 32-bit systems.
+#define _FILE_OFFSET_BITS 64
 
-#define MEM_STEP_SIZE 32768u
-#define SAFE false
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libnib.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NIB_MMAP
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#elif defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+// The offsets of ftell() are only 32-bit on some systems.
+#if defined(NIB_MMAP)
+#define SEEK_FILE fseeko
+#define TELL_FILE ftello
+#elif defined(_WIN32)
+#define SEEK_FILE _fseeki64
+#define TELL_FILE _ftelli64
+#else
+#define SEEK_FILE fseek
+#define TELL_FILE ftell
+#endif
+
+// Batches are run on several threads when the platform supports them, and on the main thread otherwise.
+#if defined(NIB_MMAP)
+#define NIB_POSIX_THREADS
+#include <pthread.h>
+#include <stdatomic.h>
+#elif defined(_WIN32)
+#define NIB_WINDOWS_THREADS
+#include <windows.h>
+#endif
+
+#define STATISTICS false
+#define JOBS 0
+#define PROFILE_LOOPS 10
+#define CACHE false
+#define MAX_STEPS 0
+#define STREAM false
+
+// The exit codes of runs that were stopped before the end of their script without failing, so that they can be told
+// apart from errors.
+#define EXIT_STEP_LIMIT 2
+#define EXIT_TIMEOUT 3
+#define EXIT_CANCELLED 4
+#define EXIT_MEMORY_LIMIT 5
+
+/**
+ * Writes an error to STDERR and terminates the program with the status code 1.
+ *
+ * @param[in] format The format of the error.
+ * @param[in] ... The additional arguments for the error format.
+ */
+static void error(const char* format, ...) {
+    va_list va;
+    va_start(va, format);
+
+    vfprintf(stderr, format, va);
+
+    va_end(va);
+    exit(1);
+}
+
+/**
+ * Loads the whole contents of a file, by mapping it in memory if possible and by reading it otherwise.
+ *
+ * @param[in] input The file to load.
+ * @param[out] size The size of the file, in bytes.
+ * @param[out] mapped Whether or not the contents were mapped, instead of read.
+ * @param[out] reason The reason why the contents could not be loaded, if any.
+ *
+ * @return The contents of the file, or NULL if they could not be loaded.
+ */
+static uint8_t* loadFile(FILE* input, size_t* size, bool* mapped, const char** reason) {
+    *mapped = false;
+    *reason = "Could not read input file";
+
+#ifdef NIB_MMAP
+    struct stat status;
+
+    if(fstat(fileno(input), &status) == 0 && S_ISREG(status.st_mode)) {
+        if((uint64_t) status.st_size > SIZE_MAX / 2) {
+            *reason = "Could not determine input file size (file could be too large)";
+            return NULL;
+        }
+
+        *size = (size_t) status.st_size;
+
+        // Empty files can't be mapped, but there is nothing to read anyway.
+        if(*size == 0)
+            return (uint8_t*) malloc(1);
+
+        void* contents = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fileno(input), 0);
+        if(contents != MAP_FAILED) {
+            // The contents are only read once, from start to end.
+            madvise(contents, *size, MADV_SEQUENTIAL);
+            *mapped = true;
+            return (uint8_t*) contents;
+        }
+    }
+#endif
+
+    // Get the input size.
+    SEEK_FILE(input, 0, SEEK_END);
+    const int64_t fileSize = (int64_t) TELL_FILE(input);
+    if(fileSize < 0 || (uint64_t) fileSize > SIZE_MAX / 2) {
+        *reason = "Could not determine input file size (file could be too large)";
+        return NULL;
+    }
+    SEEK_FILE(input, 0, SEEK_SET);
+
+    // Read the input.
+    *size = (size_t) fileSize;
+    uint8_t* contents = (uint8_t*) malloc(*size > 0 ? *size : 1);
+    if(contents == NULL)
+        return NULL;
+
+    fread(contents, 1, *size, input);
+    if(ferror(input)) {
+        free(contents);
+        return NULL;
+    }
+    return contents;
+}
+
+/**
+ * Unloads the contents of a file that were loaded by loadFile().
+ *
+ * @param[in, out] contents The contents of the file.
+ * @param[in] size The size of the file, in bytes.
+ * @param[in] mapped Whether or not the contents were mapped.
+ */
+static void unloadFile(uint8_t* contents, const size_t size, const bool mapped) {
+#ifdef NIB_MMAP
+    if(mapped) {
+        munmap(contents, size);
+        return;
+    }
+#else
+    (void) size;
+    (void) mapped;
+#endif
+    free(contents);
+}
+
+/**
+ * Compiles a script and loads it into a virtual machine, by using the cache file of the script if needed.
+ *
+ * The cache file is next to the script, and has the .nibc extension (e.g. script.nib uses script.nibc).
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in] source The contents of the script.
+ * @param[in] size The size of the script, in bytes.
+ * @param[in] script The path of the script.
+ * @param[in] cache Whether or not to use the cache file.
+ *
+ * @return NIB_OK, or the reason why the script could not be loaded.
+ */
+static enum NIB_STATUS loadScript(nib_vm* vm, const uint8_t* source, const size_t size, const char* script, const bool cache) {
+    if(!cache)
+        return nibLoad(vm, source, size);
+
+    // Replace the .nib extension, or append the cache extension if the script has another one.
+    size_t length = strlen(script);
+    if(length >= 4 && strcmp(script + length - 4, ".nib") == 0)
+        length -= 4;
+
+    char* path = (char*) malloc(length + sizeof(".nibc"));
+    if(path == NULL)
+        return NIB_ERROR_MEMORY;
+
+    memcpy(path, script, length);
+    memcpy(path + length, ".nibc", sizeof(".nibc"));
+
+    const enum NIB_STATUS status = nibLoadCached(vm, source, size, path);
+    free(path);
+    return status;
+}
+
+/**
+ * Formats the error of a virtual machine.
+ *
+ * @param[out] message The formatted error.
+ * @param[in] size The size of the message buffer, in bytes.
+ * @param[in] status The error.
+ * @param[in] inputIndex The input index of the error.
+ */
+static void formatVmError(char* message, const size_t size, const enum NIB_STATUS status, const uint64_t inputIndex) {
+    switch(status) {
+        case NIB_ERROR_TOO_LARGE: {
+            snprintf(message, size, "Could not determine input file size (file could be too large)");
+            break;
+        }
+        case NIB_ERROR_UNEXPECTED_LOOP_END: {
+            snprintf(message, size, "Unexpected end of loop at input index '%llu'", (unsigned long long) inputIndex);
+            break;
+        }
+        case NIB_ERROR_EXPECTED_LOOP_END: {
+            snprintf(message, size, "Expected end of loop for the loop at input index '%llu'", (unsigned long long) inputIndex);
+            break;
+        }
+        case NIB_ERROR_OUT_OF_BOUNDS: {
+            snprintf(message, size, "Data index out of bounds at input index '%llu'", (unsigned long long) inputIndex);
+            break;
+        }
+        case NIB_ERROR_MEMORY: {
+            snprintf(message, size, "Could not allocate memory");
+            break;
+        }
+        case NIB_ERROR_OUTPUT: {
+            snprintf(message, size, "Could not write the output");
+            break;
+        }
+        case NIB_ERROR_MEMORY_LIMIT: {
+            snprintf(message, size, "Memory limit reached at input index '%llu'", (unsigned long long) inputIndex);
+            break;
+        }
+        case NIB_STEP_LIMIT: {
+            snprintf(message, size, "Step limit reached at input index '%llu'", (unsigned long long) inputIndex);
+            break;
+        }
+        case NIB_TIMEOUT: {
+            snprintf(message, size, "Time limit reached at input index '%llu'", (unsigned long long) inputIndex);
+            break;
+        }
+        case NIB_CANCELLED: {
+            snprintf(message, size, "Cancelled at input index '%llu'", (unsigned long long) inputIndex);
+            break;
+        }
+        default: {
+            snprintf(message, size, "Could not run the script");
+            break;
+        }
+    }
+}
+
+/**
+ * Writes the error of a virtual machine to STDERR, destroys it and terminates the program. Runs that were stopped by
+ * a limit or cancelled have their own status codes, and the other errors have the status code 1.
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in] status The error.
+ */
+static void vmError(nib_vm* vm, const enum NIB_STATUS status) {
+    char message[128];
+    formatVmError(message, sizeof(message), status, nibErrorIndex(vm));
+    nibDestroy(vm);
+
+    fprintf(stderr, "%s", message);
+    switch(status) {
+        case NIB_STEP_LIMIT:
+            exit(EXIT_STEP_LIMIT);
+        case NIB_TIMEOUT:
+            exit(EXIT_TIMEOUT);
+        case NIB_CANCELLED:
+            exit(EXIT_CANCELLED);
+        case NIB_ERROR_MEMORY_LIMIT:
+            exit(EXIT_MEMORY_LIMIT);
+        default:
+            exit(1);
+    }
+}
+
+// The virtual machine that is cancelled by an interrupt, if it's running.
+static nib_vm* volatile interruptedVm = NULL;
+
+/**
+ * Handles an interrupt by cancelling the running virtual machine. Another interrupt terminates the program, in case
+ * the script is waiting for the input.
+ *
+ * @param[in] number The number of the signal.
+ */
+static void handleInterrupt(int number) {
+    (void) number;
+    signal(SIGINT, SIG_DFL);
+
+    nib_vm* vm = interruptedVm;
+    if(vm != NULL)
+        nibCancel(vm);
+}
+
+/**
+ * Writes what the profiler counted to STDERR, including the hottest loops.
+ *
+ * @param[in] vm The virtual machine.
+ * @param[in] loopCount The maximum amount of loops to write.
+ */
+static void writeProfile(const nib_vm* vm, const uint32_t loopCount) {
+    struct NibProfile profile;
+    if(!nibGetProfile(vm, &profile))
+        return;
+
+    fprintf(stderr, "Ran %llu operations in %llu steps, reached data index %llu and spent %.6f seconds on I/O\n",
+            (unsigned long long) profile.operations, (unsigned long long) profile.steps, (unsigned long long) profile.maxDataIndex, profile.ioSeconds);
+
+    struct NibLoopProfile* loops = (struct NibLoopProfile*) malloc(loopCount * sizeof(struct NibLoopProfile));
+    if(loops == NULL)
+        return;
+
+    const uint32_t count = nibGetHotLoops(vm, loops, loopCount);
+    for(uint32_t i = 0; i < count && i < loopCount; ++i) {
+        const struct NibLoopProfile* loop = loops + i;
+        const double share = profile.operations > 0 ? 100.0 * (double) loop->operations / (double) profile.operations : 0;
+
+        fprintf(stderr, "Loop at input index '%llu': %llu iterations, %llu operations (%.1f%%)\n", (unsigned long long) loop->inputIndex,
+                (unsigned long long) loop->iterations, (unsigned long long) loop->operations, share);
+    }
+
+    free(loops);
+}
+
+/**
+ * Writes the amount of loops that were replaced with faster operations or copied, and what was precomputed, to STDERR.
+ *
+ * @param[in] vm The virtual machine.
+ */
+static void writeStatistics(const nib_vm* vm) {
+    const struct IdiomStatistics* idioms = nibStatistics(vm);
+    fprintf(stderr, "Replaced %u clear loops, %u multiplication loops and %u scan loops, and copied %u balanced loops\n", idioms->clearLoops, idioms->multiplyLoops, idioms->scanLoops, idioms->balancedLoops);
+
+    struct NibSnapshot snapshot;
+    if(nibGetSnapshot(vm, &snapshot))
+        fprintf(stderr, "Precomputed %llu steps and %llu bytes of output, up to input index '%llu'\n", (unsigned long long) snapshot.steps, (unsigned long long) snapshot.outputSize, (unsigned long long) snapshot.inputIndex);
+}
+
+/**
+ * Loads a script from a FILE pointer into a virtual machine, and runs it.
+ *
+ * The file is mapped in memory when possible, and read otherwise.
+ *
+ * @param[in, out] input The pointer to the input FILE pointer.
+ * @param[in] options The virtual machine options.
+ * @param[in] statistics Whether or not to write the idiom statistics to STDERR.
+ * @param[in] profileLoops The maximum amount of loops to write when profiling.
+ * @param[in] emitPath The path to transpile the script to instead of running it, or NULL to run it.
+ * @param[in] script The path of the script.
+ * @param[in] cache Whether or not to use the cache file of the script.
+ * @param[in] maxSteps The maximum amount of steps to run the script for, or 0 for no limit.
+ *
+ * @note The input FILE* is passed by using a pointer because it will be modified inside this function (it will be closed).
+ */
+static void run(FILE** input, const struct NibOptions* options, const bool statistics, const uint32_t profileLoops, const char* emitPath, const char* script, const bool cache, const uint64_t maxSteps) {
+    // Load the input.
+    size_t fileSize = 0;
+    bool fileMapped = false;
+    const char* reason;
+    uint8_t* fileData = loadFile(*input, &fileSize, &fileMapped, &reason);
+    fclose(*input);
+    if(fileData == NULL)
+        error("%s", reason);
+
+    nib_vm* vm = nibCreate(options, NULL);
+    if(vm == NULL) {
+        unloadFile(fileData, fileSize, fileMapped);
+        error("Could not allocate memory for the data array");
+    }
+
+    // Compile the input, which is no longer needed afterwards. Unbalanced loops are rejected here.
+    enum NIB_STATUS status = loadScript(vm, fileData, fileSize, script, cache);
+    unloadFile(fileData, fileSize, fileMapped);
+    if(status != NIB_OK)
+        vmError(vm, status);
+
+    if(statistics)
+        writeStatistics(vm);
+
+    if(emitPath != NULL) {
+        FILE* output = fopen(emitPath, "w");
+        const bool emitted = output != NULL && nibEmitC(vm, output);
+
+        nibDestroy(vm);
+        if(output == NULL || fclose(output) != 0 || !emitted)
+            error("Could not write the C source to '%s'", emitPath);
+        return;
+    }
+
+    interruptedVm = vm;
+    signal(SIGINT, handleInterrupt);
+    status = nibRun(vm, maxSteps);
+    signal(SIGINT, SIG_DFL);
+    interruptedVm = NULL;
+
+    writeProfile(vm, profileLoops);
+    if(status != NIB_OK)
+        vmError(vm, status);
+
+    nibDestroy(vm);
+}
+
+/**
+ * Reads the next chunk of a streamed script, returning as soon as some bytes are available.
+ *
+ * @param[in] context The FILE pointer of the script.
+ * @param[out] bytes The bytes that were read.
+ * @param[in] size The maximum amount of bytes to read.
+ *
+ * @return The amount of bytes that were read, or 0 if the script has ended.
+ */
+static size_t readScript(void* context, uint8_t* bytes, const size_t size) {
+    FILE* input = (FILE*) context;
+
+    // Unlike fread(), read() returns as soon as some bytes are available, so the script can start running before
+    // the whole chunk is written by the other end of the pipe.
+#if defined(NIB_MMAP)
+    ssize_t count;
+    do {
+        count = read(fileno(input), bytes, size);
+    } while(count < 0 && errno == EINTR);
+
+    return count > 0 ? (size_t) count : 0;
+#else
+    return fread(bytes, 1, size, input);
+#endif
+}
+
+/**
+ * Writes bytes to STDOUT.
+ *
+ * @param[in] context The context of the I/O, which is not used.
+ * @param[in] bytes The bytes to write.
+ * @param[in] size The amount of bytes to write.
+ *
+ * @return Whether or not all bytes were written.
+ */
+static bool writeStreamOutput(void* context, const uint8_t* bytes, const size_t size) {
+    (void) context;
+
+    return fwrite(bytes, 1, size, stdout) == size && fflush(stdout) == 0;
+}
+
+/**
+ * Reads nothing, as the input of a script that is streamed from STDIN has already ended.
+ *
+ * @param[in] context The context of the I/O, which is not used.
+ * @param[out] bytes The bytes that were read, which are not written.
+ * @param[in] size The maximum amount of bytes to read.
+ *
+ * @return 0, as the input has ended.
+ */
+static size_t readNoInput(void* context, uint8_t* bytes, const size_t size) {
+    (void) context;
+    (void) bytes;
+    (void) size;
+
+    return 0;
+}
+
+/**
+ * Runs a script from a FILE pointer while it's being read, which works for pipes as well.
+ *
+ * @param[in, out] input The FILE pointer of the script, which is closed afterwards unless it's STDIN.
+ * @param[in] options The virtual machine options.
+ * @param[in] statistics Whether or not to write the idiom statistics to STDERR.
+ * @param[in] maxSteps The maximum amount of steps to run the script for, or 0 for no limit.
+ */
+static void runStream(FILE* input, const struct NibOptions* options, const bool statistics, const uint64_t maxSteps) {
+    // A script that is streamed from STDIN takes up all of it, so the input of the script has already ended.
+    static const struct NibIo scriptIo = { writeStreamOutput, readNoInput, NULL };
+    const bool standardInput = input == stdin;
+
+#ifdef _WIN32
+    if(standardInput)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+
+    nib_vm* vm = nibCreate(options, standardInput ? &scriptIo : NULL);
+    if(vm == NULL)
+        error("Could not allocate memory for the data array");
+
+    interruptedVm = vm;
+    signal(SIGINT, handleInterrupt);
+    const enum NIB_STATUS status = nibRunStream(vm, readScript, input, maxSteps);
+    signal(SIGINT, SIG_DFL);
+    interruptedVm = NULL;
+
+    if(!standardInput)
+        fclose(input);
+
+    if(statistics)
+        writeStatistics(vm);
+    if(status != NIB_OK)
+        vmError(vm, status);
+
+    nibDestroy(vm);
+}
+
+/**
+ * Represents a script of a batch.
+ */
+struct BatchJob {
+    // The path of the script.
+    char* script;
+    // The path of the file that the output of the script is written to.
+    char* output;
+    // Whether or not the output path was allocated separately, instead of being part of the manifest.
+    bool ownsOutput;
+};
+
+/**
+ * Represents a batch of scripts, which are shared by all workers.
+ */
+struct Batch {
+    struct BatchJob* jobs;
+    uint32_t jobCount;
+    // The index of the next script to run.
+#if defined(NIB_POSIX_THREADS)
+    atomic_uint_fast32_t nextJob;
+#elif defined(NIB_WINDOWS_THREADS)
+    volatile LONG nextJob;
+#else
+    uint32_t nextJob;
+#endif
+    // Whether or not the scripts use their cache files.
+    bool cache;
+    // The maximum amount of steps to run every script for, or 0 for no limit.
+    uint64_t maxSteps;
+    // Whether or not any script failed.
+    volatile bool failed;
+};
+
+/**
+ * Represents a worker thread, which runs scripts until the batch is done.
+ */
+struct BatchWorker {
+    struct Batch* batch;
+    // The virtual machine that runs the scripts of this worker, so that its memory is reused.
+    nib_vm* vm;
+    // The output file of the script that is running.
+    FILE* output;
+};
+
+/**
+ * Writes bytes to the output file of a worker.
+ *
+ * @param[in] context The worker.
+ * @param[in] bytes The bytes to write.
+ * @param[in] size The amount of bytes to write.
+ *
+ * @return Whether or not all bytes were written.
+ */
+static bool writeBatchOutput(void* context, const uint8_t* bytes, const size_t size) {
+    struct BatchWorker* worker = (struct BatchWorker*) context;
+
+    return fwrite(bytes, 1, size, worker->output) == size;
+}
+
+/**
+ * Reads bytes from the input of a batch script, which is always empty.
+ *
+ * @param[in] context The worker, which is not used.
+ * @param[out] bytes The bytes that were read, which are never written.
+ * @param[in] size The maximum amount of bytes to read, which is not used.
+ *
+ * @return 0, as the input has ended.
+ */
+static size_t readBatchInput(void* context, uint8_t* bytes, const size_t size) {
+    (void) context;
+    (void) bytes;
+    (void) size;
+
+    return 0;
+}
+
+/**
+ * Takes the next script of a batch.
+ *
+ * @param[in, out] batch The batch.
+ *
+ * @return The index of the script, or a value past the last script if the batch is done.
+ */
+static uint32_t takeJob(struct Batch* batch) {
+#if defined(NIB_POSIX_THREADS)
+    return (uint32_t) atomic_fetch_add_explicit(&batch->nextJob, 1, memory_order_relaxed);
+#elif defined(NIB_WINDOWS_THREADS)
+    return (uint32_t) InterlockedIncrement(&batch->nextJob) - 1;
+#else
+    return batch->nextJob++;
+#endif
+}
+
+/**
+ * Loads a script of a batch into the virtual machine of a worker, and runs it.
+ *
+ * Errors are written to STDERR, and only stop the script that caused them.
+ *
+ * @param[in, out] worker The worker.
+ * @param[in] job The script.
+ *
+ * @return Whether or not the script was run until its end.
+ */
+static bool runJob(struct BatchWorker* worker, const struct BatchJob* job) {
+    FILE* input = fopen(job->script, "rb");
+    if(input == NULL) {
+        fprintf(stderr, "%s: Invalid input file, or insufficient permissions\n", job->script);
+        return false;
+    }
+
+    size_t fileSize = 0;
+    bool fileMapped = false;
+    const char* reason;
+    uint8_t* fileData = loadFile(input, &fileSize, &fileMapped, &reason);
+    fclose(input);
+    if(fileData == NULL) {
+        fprintf(stderr, "%s: %s\n", job->script, reason);
+        return false;
+    }
+
+    enum NIB_STATUS status = loadScript(worker->vm, fileData, fileSize, job->script, worker->batch->cache);
+    unloadFile(fileData, fileSize, fileMapped);
+
+    if(status == NIB_OK) {
+        worker->output = fopen(job->output, "wb");
+        if(worker->output == NULL) {
+            fprintf(stderr, "%s: Could not open the output file '%s'\n", job->script, job->output);
+            return false;
+        }
+
+        status = nibRun(worker->vm, worker->batch->maxSteps);
+        if(fclose(worker->output) != 0 && status == NIB_OK)
+            status = NIB_ERROR_OUTPUT;
+        worker->output = NULL;
+    }
+
+    if(status != NIB_OK) {
+        char message[128];
+        formatVmError(message, sizeof(message), status, nibErrorIndex(worker->vm));
+        fprintf(stderr, "%s: %s\n", job->script, message);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Runs the scripts of a batch until there are none left.
+ *
+ * @param[in, out] worker The worker.
+ */
+static void runWorker(struct BatchWorker* worker) {
+    struct Batch* batch = worker->batch;
+
+    for(uint32_t index = takeJob(batch); index < batch->jobCount; index = takeJob(batch)) {
+        if(!runJob(worker, batch->jobs + index))
+            batch->failed = true;
+    }
+}
+
+#if defined(NIB_POSIX_THREADS)
+static void* startWorker(void* worker) {
+    runWorker((struct BatchWorker*) worker);
+    return NULL;
+}
+#elif defined(NIB_WINDOWS_THREADS)
+static DWORD WINAPI startWorker(LPVOID worker) {
+    runWorker((struct BatchWorker*) worker);
+    return 0;
+}
+#endif
+
+/**
+ * Gets the amount of processors that can run threads.
+ *
+ * @return The amount of processors, which is at least 1.
+ */
+static uint32_t countProcessors(void) {
+#if defined(NIB_POSIX_THREADS)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t) count : 1;
+#elif defined(NIB_WINDOWS_THREADS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (uint32_t) info.dwNumberOfProcessors : 1;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * Reads the scripts of a batch from a manifest.
+ *
+ * Every line of the manifest is the path of a script, optionally followed by a tab and the path of its output
+ * file. If there is no output path, the output is written next to the script, with the ".out" extension appended.
+ * Empty lines are ignored.
+ *
+ * @param[in] contents The contents of the manifest, as a string that is split into the paths.
+ * @param[out] jobs The scripts of the batch.
+ *
+ * @return The amount of scripts.
+ */
+static uint32_t parseManifest(char* contents, struct BatchJob** jobs) {
+    uint32_t count = 0;
+    uint32_t capacity = 64;
+    *jobs = (struct BatchJob*) malloc(capacity * sizeof(struct BatchJob));
+    if(*jobs == NULL)
+        error("Could not allocate memory for the batch");
+
+    for(char* line = contents; *line != '\0';) {
+        char* end = line + strcspn(line, "\r\n");
+        char* next = end + strspn(end, "\r\n");
+        *end = '\0';
+
+        if(*line != '\0') {
+            if(count == capacity) {
+                capacity *= 2;
+                struct BatchJob* grown = (struct BatchJob*) realloc(*jobs, capacity * sizeof(struct BatchJob));
+                if(grown == NULL)
+                    error("Could not allocate memory for the batch");
+                *jobs = grown;
+            }
+
+            struct BatchJob* job = *jobs + count++;
+            job->script = line;
+
+            char* separator = strchr(line, '\t');
+            if(separator != NULL && *(separator + 1) != '\0') {
+                *separator = '\0';
+                job->output = separator + 1;
+                job->ownsOutput = false;
+            } else {
+                if(separator != NULL)
+                    *separator = '\0';
+
+                const size_t length = strlen(line);
+                job->output = (char*) malloc(length + sizeof(".out"));
+                if(job->output == NULL)
+                    error("Could not allocate memory for the batch");
+                memcpy(job->output, line, length);
+                memcpy(job->output + length, ".out", sizeof(".out"));
+                job->ownsOutput = true;
+            }
+        }
+
+        line = next;
+    }
+
+    return count;
+}
+
+/**
+ * Runs every script of a manifest on a pool of worker threads, and writes the output of each one to its own file.
+ *
+ * Every worker takes the next script that no other worker has taken, so the workers stay busy until the batch
+ * is done, and reuses the memory of its virtual machine for all of its scripts. Scripts read no input.
+ *
+ * @param[in, out] manifest The manifest file, which is closed.
+ * @param[in] options The virtual machine options.
+ * @param[in] workerCount The amount of worker threads, or 0 to use one for every processor.
+ * @param[in] cache Whether or not the scripts use their cache files.
+ * @param[in] maxSteps The maximum amount of steps to run every script for, or 0 for no limit.
+ *
+ * @return Whether or not every script was run until its end.
+ */
+static bool runBatch(FILE* manifest, const struct NibOptions* options, uint32_t workerCount, const bool cache, const uint64_t maxSteps) {
+    size_t fileSize = 0;
+    bool fileMapped = false;
+    const char* reason;
+    uint8_t* fileData = loadFile(manifest, &fileSize, &fileMapped, &reason);
+    fclose(manifest);
+    if(fileData == NULL)
+        error("%s", reason);
+
+    // The paths are split in place, so the manifest needs a writable copy.
+    char* contents = (char*) malloc(fileSize + 1);
+    if(contents == NULL)
+        error("Could not allocate memory for the batch");
+    memcpy(contents, fileData, fileSize);
+    *(contents + fileSize) = '\0';
+    unloadFile(fileData, fileSize, fileMapped);
+
+    struct Batch batch;
+    batch.jobCount = parseManifest(contents, &batch.jobs);
+    batch.nextJob = 0;
+    batch.cache = cache;
+    batch.maxSteps = maxSteps;
+    batch.failed = false;
+
+#if defined(NIB_POSIX_THREADS) || defined(NIB_WINDOWS_THREADS)
+    if(workerCount == 0)
+        workerCount = countProcessors();
+#else
+    workerCount = 1;
+#endif
+    if(workerCount > batch.jobCount)
+        workerCount = batch.jobCount > 0 ? batch.jobCount : 1;
+
+    struct BatchWorker* workers = (struct BatchWorker*) calloc(workerCount, sizeof(struct BatchWorker));
+    if(workers == NULL)
+        error("Could not allocate memory for the batch");
+
+    // Every worker writes to the output file of its own script.
+    struct NibOptions workerOptions = *options;
+    workerOptions.lineBuffered = false;
+    workerOptions.profile = false;
+
+    for(uint32_t i = 0; i < workerCount; ++i) {
+        struct BatchWorker* worker = workers + i;
+        const struct NibIo io = { writeBatchOutput, readBatchInput, worker };
+
+        worker->batch = &batch;
+        worker->vm = nibCreate(&workerOptions, &io);
+        if(worker->vm == NULL)
+            error("Could not allocate memory for the data array");
+    }
+
+    // The main thread is the first worker.
+#if defined(NIB_POSIX_THREADS)
+    pthread_t* threads = (pthread_t*) malloc(workerCount * sizeof(pthread_t));
+    uint32_t threadCount = 1;
+
+    for(; threads != NULL && threadCount < workerCount; ++threadCount) {
+        if(pthread_create(threads + threadCount, NULL, startWorker, workers + threadCount) != 0)
+            break;
+    }
+#elif defined(NIB_WINDOWS_THREADS)
+    HANDLE* threads = (HANDLE*) malloc(workerCount * sizeof(HANDLE));
+    uint32_t threadCount = 1;
+
+    for(; threads != NULL && threadCount < workerCount; ++threadCount) {
+        *(threads + threadCount) = CreateThread(NULL, 0, startWorker, workers + threadCount, 0, NULL);
+        if(*(threads + threadCount) == NULL)
+            break;
+    }
+#endif
+
+    runWorker(workers);
+
+#if defined(NIB_POSIX_THREADS)
+    for(uint32_t i = 1; i < threadCount; ++i)
+        pthread_join(*(threads + i), NULL);
+    free(threads);
+#elif defined(NIB_WINDOWS_THREADS)
+    for(uint32_t i = 1; i < threadCount; ++i) {
+        WaitForSingleObject(*(threads + i), INFINITE);
+        CloseHandle(*(threads + i));
+    }
+    free(threads);
+#endif
+
+    for(uint32_t i = 0; i < workerCount; ++i)
+        nibDestroy((workers + i)->vm);
+    for(uint32_t i = 0; i < batch.jobCount; ++i) {
+        if((batch.jobs + i)->ownsOutput)
+            free((batch.jobs + i)->output);
+    }
+    free(workers);
+    free(batch.jobs);
+    free(contents);
+
+    return !batch.failed;
+}
 
 /**
  * The main function.
@@ -38,15 +897,31 @@ int main(int argc, char **argv) {
         error("Invalid arguments");
     }
 
-    // Ignore the executable name and jump straight to the file name.
-    FILE* inputFile = fopen(*(++argv), "r");
+    // Ignore the executable name and jump straight to the file name, which is a manifest in batch mode.
+    const bool batch = strcmp("--batch", *(++argv)) == 0;
+    if(batch) {
+        if(argc < 3)
+            error("Expected batch manifest");
+        ++argv;
+        --argc;
+    }
+
+    // A script named "-" is streamed from STDIN.
+    const char* script = *argv;
+    FILE* inputFile = !batch && strcmp("-", script) == 0 ? stdin : fopen(script, "rb");
     if(inputFile == NULL)
         error("Invalid input file, or insufficient permissions");
 
-    // The amount of extra memory to allocate for the data array and loops stack when they run out of it, in bytes.
-    uint32_t memStepSize = MEM_STEP_SIZE;
-    // Whether or not to interpret safely and to ignore some invalid instructions (e.g. moving to a negative index).
-    bool safe = SAFE;
+    // The interpreter options.
+    struct NibOptions options;
+    nibDefaultOptions(&options);
+    bool statistics = STATISTICS;
+    uint32_t jobs = JOBS;
+    uint32_t profileLoops = PROFILE_LOOPS;
+    const char* emitPath = NULL;
+    bool cache = CACHE;
+    uint64_t maxSteps = MAX_STEPS;
+    bool stream = inputFile == stdin || STREAM;
 
     // Jump to additional arguments.
     ++argv;
@@ -62,16 +937,146 @@ int main(int argc, char **argv) {
         if(strcmp("-m", *argv) == 0 || strcmp("--memory-size", *argv) == 0) {
             if (argc == 1)
                 error("Expected memory step size");
-            memStepSize = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
+            options.memStepSize = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
             --argc;
 
-            if (memStepSize == 0 || errno == ERANGE)
+            if (options.memStepSize == 0 || errno == ERANGE)
                 error("Invalid memory step size");
         } else if(strcmp("-s", *argv) == 0 || strcmp("--safe", *argv) == 0) {
-            safe = true;
+            options.safe = true;
+        } else if(strcmp("-e", *argv) == 0 || strcmp("--engine", *argv) == 0) {
+            if (argc == 1)
+                error("Expected engine name");
+            --argc;
+            ++argv;
+
+            if(strcmp("classic", *argv) == 0)
+                options.engine = NIB_ENGINE_CLASSIC;
+            else if(strcmp("threaded", *argv) == 0)
+                options.engine = NIB_ENGINE_THREADED;
+            else if(strcmp("jit", *argv) == 0)
+                options.engine = NIB_ENGINE_JIT;
+            else error("Invalid engine '%s'", *argv);
+        } else if(strcmp("--jit", *argv) == 0) {
+            options.engine = NIB_ENGINE_JIT;
+        } else if(strcmp("--stats", *argv) == 0) {
+            statistics = true;
+        } else if(strcmp("-p", *argv) == 0 || strcmp("--packed", *argv) == 0) {
+            options.packed = true;
+        } else if(strcmp("-b", *argv) == 0 || strcmp("--buffer-size", *argv) == 0) {
+            if (argc == 1)
+                error("Expected buffer size");
+            options.bufferSize = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if (options.bufferSize == 0 || errno == ERANGE)
+                error("Invalid buffer size");
+        } else if(strcmp("-l", *argv) == 0 || strcmp("--line-buffered", *argv) == 0) {
+            options.lineBuffered = true;
+        } else if(strcmp("--paged", *argv) == 0) {
+            options.paged = true;
+        } else if(strcmp("--cell-bits", *argv) == 0) {
+            if (argc == 1)
+                error("Expected cell width");
+            options.cellBits = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if ((options.cellBits != 8 && options.cellBits != 16 && options.cellBits != 32) || errno == ERANGE)
+                error("Invalid cell width");
+        } else if(strcmp("--profile", *argv) == 0) {
+            options.profile = true;
+        } else if(strcmp("--profile-loops", *argv) == 0) {
+            if (argc == 1)
+                error("Expected loop count");
+            profileLoops = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if (profileLoops == 0 || errno == ERANGE)
+                error("Invalid loop count");
+            options.profile = true;
+        } else if(strcmp("--emit-c", *argv) == 0) {
+            if (argc == 1)
+                error("Expected output file");
+            emitPath = *(++argv);
+            --argc;
+        } else if(strcmp("--stream", *argv) == 0) {
+            stream = true;
+        } else if(strcmp("-c", *argv) == 0 || strcmp("--cache", *argv) == 0) {
+            cache = true;
+        } else if(strcmp("-j", *argv) == 0 || strcmp("--jobs", *argv) == 0) {
+            if (argc == 1)
+                error("Expected job count");
+            jobs = (uint32_t) strtol(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if (jobs == 0 || errno == ERANGE)
+                error("Invalid job count");
+        } else if(strcmp("--max-steps", *argv) == 0) {
+            if (argc == 1)
+                error("Expected step count");
+            maxSteps = (uint64_t) strtoull(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if (maxSteps == 0 || errno == ERANGE)
+                error("Invalid step count");
+        } else if(strcmp("--precompute", *argv) == 0) {
+            if (argc == 1)
+                error("Expected step count");
+            options.precomputeSteps = (uint64_t) strtoull(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if (options.precomputeSteps == 0 || errno == ERANGE)
+                error("Invalid step count");
+        } else if(strcmp("--max-memory", *argv) == 0) {
+            if (argc == 1)
+                error("Expected memory limit");
+            options.maxMemory = (uint64_t) strtoull(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if (options.maxMemory == 0 || errno == ERANGE)
+                error("Invalid memory limit");
+        } else if(strcmp("--reserved-memory", *argv) == 0) {
+            if (argc == 1)
+                error("Expected reserved memory");
+            options.reservedMemory = (uint64_t) strtoull(*(++argv), (char**) NULL, 10);
+            --argc;
+
+            if (options.reservedMemory == 0 || errno == ERANGE)
+                error("Invalid reserved memory");
+        } else if(strcmp("-t", *argv) == 0 || strcmp("--timeout", *argv) == 0) {
+            if (argc == 1)
+                error("Expected time limit");
+            // The time limit is given in seconds, but kept in milliseconds.
+            const double seconds = strtod(*(++argv), (char**) NULL);
+            --argc;
+
+            if (!(seconds > 0) || seconds > UINT32_MAX / 1000.0 || errno == ERANGE)
+                error("Invalid time limit");
+            options.timeLimit = seconds < 0.001 ? 1 : (uint32_t) (seconds * 1000.0 + 0.5);
         } else error("Invalid argument '%s'", *argv);
     }
 
+    // Terminals are expected to show every line as soon as it is written. Transpiled programs check this by themselves.
+#if defined(NIB_MMAP)
+    options.lineBuffered = options.lineBuffered || (emitPath == NULL && isatty(fileno(stdout)));
+#elif defined(_WIN32)
+    options.lineBuffered = options.lineBuffered || (emitPath == NULL && _isatty(_fileno(stdout)));
+#endif
+
+    // Streamed scripts are never whole, so they are compiled and run a part at a time.
+    if(stream && (batch || emitPath != NULL || cache || options.profile))
+        error("Streamed scripts can't be run in batches, transpiled, cached or profiled");
+    if(stream) {
+        runStream(inputFile, &options, statistics, maxSteps);
+        return 0;
+    }
+
+    if(batch)
+        return runBatch(inputFile, &options, jobs, cache, maxSteps) ? 0 : 1;
+
+    // A single script is loaded on the worker threads instead.
+    options.loadThreads = jobs != 0 ? jobs : countProcessors();
+
     // Sets up the interpreter and runs it.
-    run(&inputFile, memStepSize, safe);
-}
\ No newline at end of file
+    run(&inputFile, &options, statistics, profileLoops, emitPath, script, cache, maxSteps);
+}
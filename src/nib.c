@@ -22,15 +22,16 @@
 
 #include "nib.h"
 
-void error(const char* format, ...) {
-    va_list va;
-    va_start(va, format);
+#if defined(__SSE2__) && defined(__GNUC__)
+#define NIB_SSE2
+#include <emmintrin.h>
+#endif
 
-    vfprintf(stderr, format, va);
-
-    va_end(va);
-    exit(1);
-}
+// AVX2 is not enabled by default, so it is only used if the CPU supports it.
+#if defined(NIB_SSE2) && (defined(__x86_64__) || defined(__i386__))
+#define NIB_AVX2
+#include <immintrin.h>
+#endif
 
 void freeAll(enum POINTER_TYPE type, const uint32_t count, ...) {
     va_list va;
@@ -62,6 +63,14 @@ void freeAll(enum POINTER_TYPE type, const uint32_t count, ...) {
             }
             break;
         }
+        case OPERATION: {
+            for(uint32_t i = 0; i < count; ++i) {
+                struct Operation** pointer = va_arg(va, struct Operation**);
+                free(*pointer);
+                *pointer = NULL;
+            }
+            break;
+        }
         default: {
             break;
         }
@@ -70,286 +79,1138 @@ void freeAll(enum POINTER_TYPE type, const uint32_t count, ...) {
     va_end(va);
 }
 
-void closeAll(const uint32_t count, ...) {
-    va_list va;
-    va_start(va, count);
+bool checkRange(nib_vm* vm, const struct Operation* operation, const size_t dataIndex) {
+    // Let the loop deal with an invalid data index, and with moving to a negative index, which the safe interpreter
+    // ignores and the unsafe one rejects.
+#ifdef NIB_GUARD_PAGES
+    const size_t reserved = vm->tape.reserved;
+    if(dataIndex >= reserved || dataIndex < (size_t) -(int64_t) operation->offset)
+        return false;
 
-    for(uint32_t i = 0; i < count; ++i)
-        fclose(va_arg(va, FILE*));
+    // The new pages are committed when they are first used, unless they were not reserved.
+    return dataIndex + (uint32_t) operation->count < reserved;
+#else
+    struct Tape* tape = &vm->tape;
+    if(dataIndex >= tape->size || dataIndex < (size_t) -(int64_t) operation->offset)
+        return false;
 
-    va_end(va);
+    // If the data array can't grow, the loop fails at the move that needs it.
+    const size_t highest = dataIndex + (uint32_t) operation->count;
+    return highest < tape->size || growTape(tape, highest);
+#endif
 }
 
-void run(FILE** input, const uint32_t memStepSize, const bool safe) {
-    // Data info.
-    uint8_t* data = (uint8_t*) calloc(memStepSize, 1);
-    uint32_t dataIndex = 0;
-    uint32_t dataLimit = memStepSize;
-
-    // Loop stack info.
-    uint32_t* loopStack = calloc(memStepSize, 4);
-    uint32_t loopStackIndex = -1;
-    uint32_t loopStackLimit = memStepSize;
-
-    // Get the input size.
-    fseek(*input, 0, SEEK_END);
-    int32_t fileSize = ftell(*input);
-    if(fileSize == -1) {
-        freeAll(UINT8, 1, data);
-        freeAll(UINT32, 1, loopStack);
-        error("Could not determine input file size (file could be too large)");
+bool checkPagedRange(const nib_vm* vm, const struct Operation* operation, const size_t dataIndex) {
+    // When both the lowest and the highest values are on the current page, so is the data index, which is then
+    // valid. Otherwise, the loop must change pages, which only its moves can do.
+    const size_t pageStart = vm->tape.pageStart;
+    return dataIndex + operation->offset - pageStart < NIB_PAGE_SIZE && dataIndex + (uint32_t) operation->count - pageStart < NIB_PAGE_SIZE;
+}
+
+#define DATA_CELL_BITS 8
+#include "data.h"
+#undef DATA_CELL_BITS
+
+#ifdef NIB_SSE2
+/**
+ * Decodes a byte array by using SSE2, 16 bytes at a time.
+ *
+ * @param[in] source The byte array source to decode.
+ * @param[in] sourceSize The size of the source, in bytes.
+ * @param[out] result The decoded source, which must be twice as large as the source.
+ *
+ * @return The amount of source bytes that were decoded, which is a multiple of 16.
+ */
+static size_t decodeSse2(const uint8_t* source, const size_t sourceSize, uint8_t* result) {
+    const __m128i mask = _mm_set1_epi8(RIGHT_MASK);
+    size_t i = 0;
+
+    for(; i + 16 <= sourceSize; i += 16) {
+        const __m128i current = _mm_loadu_si128((const __m128i*) (source + i));
+
+        // There is no 8-bit shift, but the bits shifted in from the neighbouring byte are masked out.
+        const __m128i left = _mm_and_si128(_mm_srli_epi16(current, 4), mask);
+        const __m128i right = _mm_and_si128(current, mask);
+
+        // Interleave the nibbles, so that each left nibble comes before its right nibble.
+        _mm_storeu_si128((__m128i*) (result + i * 2), _mm_unpacklo_epi8(left, right));
+        _mm_storeu_si128((__m128i*) (result + i * 2 + 16), _mm_unpackhi_epi8(left, right));
     }
-    fseek(*input, 0, SEEK_SET);
-
-    // Read the input.
-    uint8_t* fileData = (uint8_t*) malloc(fileSize);
-    fread(fileData, 1, fileSize, *input);
-    if(ferror(*input)) {
-        freeAll(UINT8, 2, data, fileData);
-        freeAll(UINT32, 1, loopStack);
-        closeAll(1, *input);
-        error("Could not read input file");
+    return i;
+}
+#endif
+
+#ifdef NIB_AVX2
+/**
+ * Decodes a byte array by using AVX2, 32 bytes at a time.
+ *
+ * @param[in] source The byte array source to decode.
+ * @param[in] sourceSize The size of the source, in bytes.
+ * @param[out] result The decoded source, which must be twice as large as the source.
+ *
+ * @return The amount of source bytes that were decoded, which is a multiple of 32.
+ */
+__attribute__((target("avx2")))
+static size_t decodeAvx2(const uint8_t* source, const size_t sourceSize, uint8_t* result) {
+    const __m256i mask = _mm256_set1_epi8(RIGHT_MASK);
+    size_t i = 0;
+
+    for(; i + 32 <= sourceSize; i += 32) {
+        const __m256i current = _mm256_loadu_si256((const __m256i*) (source + i));
+        const __m256i left = _mm256_and_si256(_mm256_srli_epi16(current, 4), mask);
+        const __m256i right = _mm256_and_si256(current, mask);
+
+        // The unpack instructions work on each 128-bit lane separately, so the lanes are put back in order.
+        const __m256i low = _mm256_unpacklo_epi8(left, right);
+        const __m256i high = _mm256_unpackhi_epi8(left, right);
+
+        _mm256_storeu_si256((__m256i*) (result + i * 2), _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256((__m256i*) (result + i * 2 + 32), _mm256_permute2x128_si256(low, high, 0x31));
     }
-    fclose(*input);
-
-    // Decode the input.
-    uint8_t* inputData = NULL;
-    uint32_t inputSize = decode(fileData, fileSize, &inputData);
-    uint32_t inputIndex = 0;
-    free(fileData);
-
-    // Interpret, either normally or safely.
-    // Both interpreters could be merged into one, as they only differ in one line of code.
-    // However, it would be slower because the value of "safe" would need to be checked for every instruction.
-    // Also, merging them would make it harder for the safe interpreter to be changed in the future.
-    // There is also the option of merging them and checking the value of "safe" at the beginning, basically splitting the function body.
-    if(safe)
-        interpretSafely(memStepSize, &inputData, inputSize, &inputIndex, &data, &dataIndex, &dataLimit, &loopStack, &loopStackIndex, &loopStackLimit);
-    else interpret(memStepSize, &inputData, inputSize, &inputIndex, &data, &dataIndex, &dataLimit, &loopStack, &loopStackIndex, &loopStackLimit);
-
-    // Free the used memory.
-    freeAll(UINT8, 2, &data, &inputData);
-    freeAll(UINT32, 1, &loopStack);
+    return i;
 }
+#endif
 
-uint32_t decode(const uint8_t* source, const uint32_t sourceSize, uint8_t** result) {
-    // Result info.
-    uint32_t resultSize = sourceSize * 2;
-    uint32_t resultOffset = 0;
-    *result = (uint8_t*) malloc(resultSize);
+void decodeInto(const uint8_t* source, const size_t sourceSize, uint8_t* result) {
+    // Decode as much as possible with SIMD, and the rest one byte at a time.
+    size_t i = 0;
+
+#if defined(NIB_AVX2)
+    if(__builtin_cpu_supports("avx2"))
+        i = decodeAvx2(source, sourceSize, result);
+    else i = decodeSse2(source, sourceSize, result);
+#elif defined(NIB_SSE2)
+    i = decodeSse2(source, sourceSize, result);
+#endif
+
+    size_t resultOffset = i * 2;
 
     // Decode the source.
-    for(uint32_t i = 0; i < sourceSize; ++i) {
+    for(; i < sourceSize; ++i) {
         uint8_t current = *(source + i);
 
-        *(*result + (resultOffset++)) = (current & LEFT_MASK) >> 4u;
-        *(*result + (resultOffset++)) = current & RIGHT_MASK;
+        *(result + (resultOffset++)) = (current & LEFT_MASK) >> 4u;
+        *(result + (resultOffset++)) = current & RIGHT_MASK;
     }
+}
+
+size_t decode(const uint8_t* source, const size_t sourceSize, uint8_t** result) {
+    // Result info.
+    size_t resultSize = sourceSize * 2;
+    *result = (uint8_t*) malloc(resultSize > 0 ? resultSize : 1);
+    if(*result == NULL)
+        return 0;
+
+    decodeInto(source, sourceSize, *result);
     return resultSize;
 }
 
-void interpret(const uint32_t memStepSize, uint8_t** inputData, const int32_t inputSize, uint32_t* inputIndex, uint8_t** data, uint32_t* dataIndex, uint32_t* dataSize, uint32_t** loopStack, uint32_t* loopStackIndex, uint32_t* loopStackSize) {
-    while(*inputIndex < inputSize) {
-        uint8_t instruction;
-        bool skipLoop = false;
-        bool inputIndexChanged = false;
+/**
+ * Makes sure that an operation array has room for more operations.
+ *
+ * @param[in, out] program The operation array.
+ * @param[in, out] programLimit The amount of operations that fit in the array.
+ * @param[in] required The amount of operations that must fit in the array.
+ *
+ * @return Whether or not the memory could be allocated. If not, the array is left as it was.
+ */
+static bool reserveOperations(struct Operation** program, uint32_t* programLimit, const uint32_t required) {
+    if(required <= *programLimit)
+        return true;
+
+    // Operation indexes are 32-bit, so the array never grows past that.
+    uint64_t limit = *programLimit;
+    while(limit < required)
+        limit += limit / 2 + 16;
+    if(limit > UINT32_MAX)
+        limit = UINT32_MAX;
+    if(limit > SIZE_MAX / sizeof(struct Operation))
+        return false;
+
+    struct Operation* operations = (struct Operation*) realloc(*program, (size_t) limit * sizeof(struct Operation));
+    if(operations == NULL)
+        return false;
+
+    *program = operations;
+    *programLimit = (uint32_t) limit;
+    return true;
+}
+
+/**
+ * Inserts empty operations inside an operation array, which must have room for them.
+ *
+ * @param[in, out] program The operation array.
+ * @param[in] programSize The amount of operations in the array.
+ * @param[in] index The index at which to insert the operations.
+ * @param[in] count The amount of operations to insert.
+ */
+static void insertOperations(struct Operation* program, const uint32_t programSize, const uint32_t index, const uint32_t count) {
+    memmove(program + index + count, program + index, (programSize - index) * sizeof(struct Operation));
+    memset(program + index, 0, count * sizeof(struct Operation));
+}
+
+/**
+ * Copies a balanced loop that was just compiled without its moves, if it has no nested loops.
+ *
+ * The original loop is preceded by an OP_RANGE operation, and is followed by the copy.
+ *
+ * @param[in, out] program The operation array, which must have room for NIB_INSERT_LIMIT more operations.
+ * @param[in] start The index of the loop start.
+ * @param[in] end The index of the loop end, which is the last operation of the array.
+ * @param[out] statistics The amount of loops that were copied, or NULL.
+ *
+ * @return The new amount of operations in the array.
+ */
+static uint32_t copyBalancedLoop(struct Operation* program, const uint32_t start, const uint32_t end, struct IdiomStatistics* statistics) {
+    const uint32_t bodySize = end - start - 1;
+    if(bodySize > NIB_BALANCED_LIMIT)
+        return end + 1;
+
+    // The loop must only contain moves and operations on single values, and end at the same index it started from.
+    // Loops without moves or without other operations gain nothing from being copied.
+    int64_t offset = 0;
+    int64_t lowestOffset = 0;
+    int64_t highestOffset = 0;
+    uint32_t moveCount = 0;
+
+    for(uint32_t i = start + 1; i < end; ++i) {
+        const struct Operation* operation = program + i;
+
+        if(operation->type == OP_MOVE) {
+            offset += operation->count;
+            ++moveCount;
+
+            if(offset < lowestOffset)
+                lowestOffset = offset;
+            else if(offset > highestOffset)
+                highestOffset = offset;
+        } else if(operation->type != OP_ADD && operation->type != OP_WRITE && operation->type != OP_READ && operation->type != OP_CLEAR) {
+            return end + 1;
+        }
+    }
+
+    if(offset != 0 || moveCount == 0 || moveCount == bodySize || lowestOffset < -INT32_MAX || highestOffset > INT32_MAX)
+        return end + 1;
+
+    insertOperations(program, end + 1, start, 1);
+
+    struct Operation* range = program + start;
+    struct Operation* loop = range + 1;
+    struct Operation* loopEnd = program + end + 1;
+
+    range->type = OP_RANGE;
+    range->count = (int32_t) highestOffset;
+    range->offset = (int32_t) lowestOffset;
+    range->jump = end + 1;
+    range->inputIndex = loop->inputIndex;
+    loop->jump = end + 1;
+    loopEnd->jump = start + 1;
+
+    // The copy keeps the input indexes and the steps of the original loop, so that only the speed changes.
+    const uint32_t copyStart = end + 2;
+    uint32_t size = copyStart;
+    *(program + size++) = *loop;
+    offset = 0;
+
+    for(const struct Operation* operation = loop + 1; operation < loopEnd; ++operation) {
+        if(operation->type == OP_MOVE) {
+            offset += operation->count;
+            continue;
+        }
+
+        *(program + size) = *operation;
+        (program + size++)->offset = (int32_t) offset;
+    }
+
+    *(program + size) = *loopEnd;
+    (program + size)->jump = copyStart;
+    (program + copyStart)->jump = size;
+
+    if(statistics != NULL)
+        ++statistics->balancedLoops;
+    return size + 1;
+}
+
+/**
+ * Replaces a loop that was just compiled with faster operations, if it is a common loop.
+ *
+ * @param[in, out] program The operation array, which must have room for NIB_INSERT_LIMIT more operations.
+ * @param[in] start The index of the loop start.
+ * @param[in] end The index of the loop end, which is the last operation of the array.
+ * @param[out] statistics The amount of loops that were replaced, or NULL.
+ *
+ * @return The new amount of operations in the array.
+ */
+static uint32_t optimizeLoop(struct Operation* program, const uint32_t start, const uint32_t end, struct IdiomStatistics* statistics) {
+    const uint32_t bodySize = end - start - 1;
+    struct Operation* loop = program + start;
+
+    // Adding an odd amount always reaches 0 at some point, so [-] and [+] only set the value to 0.
+    if(bodySize == 1 && (loop + 1)->type == OP_ADD && ((loop + 1)->count & 1)) {
+        loop->type = OP_CLEAR;
+        loop->count = 0;
+        loop->jump = 0;
+
+        if(statistics != NULL)
+            ++statistics->clearLoops;
+        return start + 1;
+    }
+
+    // Loops such as [>] move until a value of 0 is found.
+    if(bodySize == 1 && (loop + 1)->type == OP_MOVE) {
+        insertOperations(program, end + 1, start, 1);
+
+        loop->type = OP_SCAN;
+        loop->count = (loop + 2)->count;
+        loop->jump = end + 1;
+        loop->inputIndex = (loop + 1)->inputIndex;
+        (loop + 1)->jump = end + 1;
+        (loop + 3)->jump = start + 1;
+
+        if(statistics != NULL)
+            ++statistics->scanLoops;
+        return end + 2;
+    }
+
+    // Loops such as [->+>++<<] only add multiples of the current value to other values. They must only contain
+    // additions and moves, end at the same index they started from, and subtract 1 from the current value.
+    int32_t offsets[NIB_MULTIPLY_LIMIT];
+    int32_t factors[NIB_MULTIPLY_LIMIT];
+    uint32_t targetCount = 0;
+    int32_t offset = 0;
+    int32_t lowestOffset = 0;
+
+    for(uint32_t i = start + 1; i < end; ++i) {
+        const struct Operation* operation = program + i;
+
+        if(operation->type == OP_MOVE) {
+            offset += operation->count;
+            if(offset < lowestOffset)
+                lowestOffset = offset;
+        } else if(operation->type == OP_ADD) {
+            uint32_t target = 0;
+            while(target < targetCount && offsets[target] != offset)
+                ++target;
+
+            if(target == targetCount) {
+                if(targetCount == NIB_MULTIPLY_LIMIT)
+                    return copyBalancedLoop(program, start, end, statistics);
+
+                offsets[target] = offset;
+                factors[target] = 0;
+                ++targetCount;
+            }
+            factors[target] += operation->count;
+        } else return copyBalancedLoop(program, start, end, statistics);
+    }
+
+    if(offset != 0)
+        return end + 1;
+
+    // Remove the current value and the values that don't change, and sort the others by offset.
+    uint32_t multiplyCount = 0;
+    bool countsDown = false;
+
+    for(uint32_t target = 0; target < targetCount; ++target) {
+        if(offsets[target] == 0) {
+            countsDown = factors[target] == -1;
+        } else if(factors[target] != 0) {
+            // The target is copied first, as shifting the sorted ones can overwrite it.
+            const int32_t targetOffset = offsets[target];
+            const int32_t targetFactor = factors[target];
+            uint32_t position = multiplyCount++;
+
+            while(position > 0 && offsets[position - 1] > targetOffset) {
+                offsets[position] = offsets[position - 1];
+                factors[position] = factors[position - 1];
+                --position;
+            }
+            offsets[position] = targetOffset;
+            factors[position] = targetFactor;
+        }
+    }
+
+    if(!countsDown)
+        return copyBalancedLoop(program, start, end, statistics);
+
+    insertOperations(program, end + 1, start, multiplyCount + 1);
+
+    loop->type = OP_MULTIPLY;
+    loop->count = (int32_t) multiplyCount;
+    loop->offset = lowestOffset;
+    loop->jump = end + multiplyCount + 1;
+    loop->inputIndex = (loop + multiplyCount + 1)->inputIndex;
+
+    for(uint32_t target = 0; target < multiplyCount; ++target) {
+        struct Operation* multiply = loop + target + 1;
+
+        multiply->type = OP_MULTIPLY_ADD;
+        multiply->count = factors[target];
+        multiply->offset = offsets[target];
+        multiply->inputIndex = loop->inputIndex;
+    }
+
+    (loop + multiplyCount + 1)->jump = end + multiplyCount + 1;
+    (program + end + multiplyCount + 1)->jump = start + multiplyCount + 1;
+
+    if(statistics != NULL)
+        ++statistics->multiplyLoops;
+    return end + multiplyCount + 2;
+}
+
+/**
+ * Gets a nibble from a source that is either decoded or packed.
+ *
+ * @param[in] source The source.
+ * @param[in] index The index of the nibble.
+ * @param[in] packed Whether or not the source is packed, with two nibbles in each byte.
+ *
+ * @return The nibble.
+ */
+static inline uint8_t getNibble(const uint8_t* source, const size_t index, const bool packed) {
+    if(!packed)
+        return *(source + index);
+
+    // The left nibble comes first.
+    const uint8_t current = *(source + index / 2);
+    return (index & 1u) ? current & RIGHT_MASK : (current & LEFT_MASK) >> 4u;
+}
+
+/**
+ * Adds the amounts of loops that were replaced in a chunk to others.
+ *
+ * @param[in, out] statistics The amounts to add to.
+ * @param[in] added The amounts to add.
+ */
+static void addStatistics(struct IdiomStatistics* statistics, const struct IdiomStatistics* added) {
+    statistics->clearLoops += added->clearLoops;
+    statistics->multiplyLoops += added->multiplyLoops;
+    statistics->scanLoops += added->scanLoops;
+    statistics->balancedLoops += added->balancedLoops;
+}
+
+/**
+ * Ends a compiled program with an OP_END operation, and gives back the memory that was reserved but not used.
+ *
+ * @param[in, out] result The compiled operations, which must have room for one more.
+ * @param[in] size The amount of compiled operations.
+ * @param[in] sourceSize The amount of nibbles in the source.
+ * @param[out] resultSize The amount of compiled operations, without the OP_END operation.
+ *
+ * @return NIB_OK.
+ */
+static enum NIB_STATUS finishProgram(struct Operation** result, const uint32_t size, const size_t sourceSize, uint32_t* resultSize) {
+    // Mark the end of the program.
+    struct Operation* end = *result + size;
+    end->type = OP_END;
+    end->count = 0;
+    end->offset = 0;
+    end->jump = 0;
+    end->inputIndex = sourceSize;
+
+    // Give back the memory that was reserved but not used, which keeps the array as it was if it fails.
+    struct Operation* operations = (struct Operation*) realloc(*result, (size + 1) * sizeof(struct Operation));
+    if(operations != NULL)
+        *result = operations;
+
+    *resultSize = size;
+    return NIB_OK;
+}
+
+/**
+ * Compiles a range of nibbles, which are either decoded or packed, to an array of operations.
+ *
+ * Loop ends that are not matched inside the range are only allowed in chunks, whose loops are matched by
+ * mergeChunks(). Loop starts that are not matched are left open.
+ *
+ * @param[in] source The source to compile.
+ * @param[in] packed Whether or not the source is packed, with two nibbles in each byte.
+ * @param[in, out] chunk The range of nibbles, and the compiled operations. A previous operation array is reused,
+ * and the array is freed if the range is rejected.
+ * @param[in] partial Whether or not the range is a chunk of a larger source.
+ * @param[out] errorIndex The input index of the loop end that is unbalanced, if any.
+ *
+ * @return NIB_OK, or the reason why the range was rejected.
+ */
+static enum NIB_STATUS compileRange(const uint8_t* source, const bool packed, struct Chunk* chunk, const bool partial, uint64_t* errorIndex) {
+    const size_t sourceSize = chunk->end;
+    struct Operation** result = &chunk->program;
+    struct IdiomStatistics* statistics = &chunk->statistics;
+
+    // Result info. Folding usually leaves far fewer operations than nibbles, so the array starts small and grows.
+    const size_t rangeSize = chunk->end - chunk->start;
+    uint32_t size = 0;
+    uint32_t resultLimit = 0;
+
+    // The indices of the loops that are still open, used to match them with their ends.
+    uint32_t* openLoops = (uint32_t*) malloc(16 * sizeof(uint32_t));
+    size_t openLoopCount = 0;
+    size_t openLoopLimit = 16;
+    // The indices of the loop ends that are matched in other chunks.
+    uint32_t* openEnds = NULL;
+    size_t openEndCount = 0;
+    size_t openEndLimit = 0;
+    // The amount of operations in the copies of balanced loops, which loops around them don't count as steps.
+    uint32_t copySize = 0;
+    // How far the moves right before the current operation go in total.
+    int64_t moved = 0;
+
+    if(openLoops == NULL || !reserveOperations(result, &resultLimit, rangeSize / 4 < NIB_PROGRAM_LIMIT ? (uint32_t) (rangeSize / 4 + 16) : NIB_PROGRAM_LIMIT)) {
+        free(openLoops);
+        freeAll(OPERATION, 1, result);
+        return NIB_ERROR_MEMORY;
+    }
+
+    for(size_t i = chunk->start; i < sourceSize; ++i) {
+        uint8_t instruction = getNibble(source, i, packed);
+
+        // Padding nibbles are dropped.
+        if(instruction & NIB_PADDING_BIT)
+            continue;
+
+        if(size > NIB_PROGRAM_LIMIT) {
+            freeAll(UINT32, 2, &openLoops, &openEnds);
+            freeAll(OPERATION, 1, result);
+            return NIB_ERROR_TOO_LARGE;
+        }
+
+        // Keep room for the OP_END operation, and for the operations that optimizeLoop() may insert.
+        if(!reserveOperations(result, &resultLimit, size + NIB_INSERT_LIMIT + 2)) {
+            freeAll(UINT32, 2, &openLoops, &openEnds);
+            freeAll(OPERATION, 1, result);
+            return NIB_ERROR_MEMORY;
+        }
+
+        struct Operation* operation = *result + size;
+        operation->inputIndex = i;
+        operation->offset = 0;
+        operation->jump = 0;
+
+        if(instruction != NIB_INCREMENT_POINTER && instruction != NIB_DECREMENT_POINTER)
+            moved = 0;
 
-        // Parse the instruction.
-        instruction = *(*inputData + *inputIndex);
-        parseInstruction(instruction, memStepSize, inputData, inputIndex, data, dataIndex, dataSize, loopStack, loopStackIndex, loopStackSize, &skipLoop, &inputIndexChanged);
+        switch(instruction) {
+            case NIB_INCREMENT_VALUE:
+            case NIB_DECREMENT_VALUE: {
+                // Increments and decrements cancel each other out, so the whole run is folded. Runs that are too long
+                // for a single count are split.
+                int32_t count = 0;
 
-        // Skip the loop.
-        if(skipLoop) {
-            uint32_t loopCount = 1;
+                for(; i < sourceSize && count != INT32_MAX && count != -INT32_MAX; ++i) {
+                    instruction = getNibble(source, i, packed);
 
-            while (loopCount > 0 && *inputIndex < inputSize) {
-                instruction = *(*inputData + ++(*inputIndex));
+                    if(instruction == NIB_INCREMENT_VALUE)
+                        ++count;
+                    else if(instruction == NIB_DECREMENT_VALUE)
+                        --count;
+                    else if(!(instruction & NIB_PADDING_BIT))
+                        break;
+                }
+                // Step back, so that the instruction which ended the run is compiled next.
+                --i;
+
+                // Runs that cancel out are kept, as they still use the value and the unsafe interpreter rejects them
+                // at a negative index.
+                operation->type = OP_ADD;
+                operation->count = count;
+                break;
+            }
+            case NIB_INCREMENT_POINTER:
+            case NIB_DECREMENT_POINTER: {
+                // Only runs that move in the same direction are folded, as the safe interpreter stops at index 0.
+                const uint8_t direction = instruction;
+                int32_t count = 0;
+
+                for(; i < sourceSize && count != INT32_MAX; ++i) {
+                    instruction = getNibble(source, i, packed);
+
+                    if(instruction == direction)
+                        ++count;
+                    else if(!(instruction & NIB_PADDING_BIT))
+                        break;
+                }
+                // Step back, so that the instruction which ended the run is compiled next.
+                --i;
+
+                // Unsafe moves are not checked, so the guard pages must catch the first value that is used after
+                // moves which follow each other. Those moves go at most as far as a single one in total, and
+                // otherwise an addition of 0 uses the value in between.
+                if(direction == NIB_DECREMENT_POINTER)
+                    count = -count;
+                if(moved + count > INT32_MAX || moved + count < INT32_MIN) {
+                    operation->type = OP_ADD;
+                    operation->count = 0;
+
+                    operation = *result + ++size;
+                    operation->inputIndex = (operation - 1)->inputIndex;
+                    operation->offset = 0;
+                    operation->jump = 0;
+                    moved = 0;
+                }
+                moved += count;
 
-                if (instruction == NIB_LOOP_START)
-                    ++loopCount;
-                else if (instruction == NIB_LOOP_END)
-                    --loopCount;
+                operation->type = OP_MOVE;
+                operation->count = count;
+                break;
             }
+            case NIB_WRITE_VALUE: {
+                operation->type = OP_WRITE;
+                operation->count = 1;
+                break;
+            }
+            case NIB_READ_VALUE: {
+                operation->type = OP_READ;
+                operation->count = 1;
+                break;
+            }
+            case NIB_LOOP_START: {
+                operation->type = OP_LOOP_START;
+                operation->count = 1;
+
+                if(openLoopCount == openLoopLimit) {
+                    uint32_t* loops = (uint32_t*) realloc(openLoops, openLoopLimit * 2 * sizeof(uint32_t));
+                    if(loops == NULL) {
+                        freeAll(UINT32, 2, &openLoops, &openEnds);
+                        freeAll(OPERATION, 1, result);
+                        return NIB_ERROR_MEMORY;
+                    }
+
+                    openLoops = loops;
+                    openLoopLimit *= 2;
+                }
+                *(openLoops + openLoopCount++) = size;
+
+                // Until the loop ends, its start keeps the amount of operations that were copied before it.
+                operation->jump = copySize;
+                break;
+            }
+            case NIB_LOOP_END: {
+                operation->type = OP_LOOP_END;
+
+                if(openLoopCount == 0) {
+                    if(!partial) {
+                        freeAll(UINT32, 1, &openLoops);
+                        freeAll(OPERATION, 1, result);
+                        *errorIndex = i;
+                        return NIB_ERROR_UNEXPECTED_LOOP_END;
+                    }
+
+                    if(openEndCount == openEndLimit) {
+                        const size_t limit = openEndLimit != 0 ? openEndLimit * 2 : 16;
+                        uint32_t* ends = (uint32_t*) realloc(openEnds, limit * sizeof(uint32_t));
+                        if(ends == NULL) {
+                            freeAll(UINT32, 2, &openLoops, &openEnds);
+                            freeAll(OPERATION, 1, result);
+                            return NIB_ERROR_MEMORY;
+                        }
+
+                        openEnds = ends;
+                        openEndLimit = limit;
+                    }
+                    *(openEnds + openEndCount++) = size;
+
+                    // Until the loop is matched, its end keeps the amount of operations that were copied before it.
+                    operation->jump = copySize;
+                    break;
+                }
+
+                // Both ends of the loop jump to each other. Every repetition counts the operations inside the loop as
+                // steps, except for the ones that were copied, so that copying loops doesn't change the steps.
+                const uint32_t start = *(openLoops + --openLoopCount);
+                operation->jump = start;
+                operation->count = (int32_t) (size - start - (copySize - (*result + start)->jump));
+                (*result + start)->jump = size;
+
+                const uint32_t end = size;
+                size = optimizeLoop(*result, start, end, statistics);
+                if((*result + start)->type == OP_RANGE)
+                    copySize += size - end - 1;
+                continue;
+            }
+            default: {
+                break;
+            }
+        }
+        ++size;
+    }
+
+    chunk->size = size;
+    chunk->openStarts = openLoops;
+    chunk->openStartCount = openLoopCount;
+    chunk->openEnds = openEnds;
+    chunk->openEndCount = openEndCount;
+    chunk->copySize = copySize;
+    return NIB_OK;
+}
+
+/**
+ * Compiles an array of nibbles, which are either decoded or packed, to an array of operations.
+ *
+ * @param[in] source The source to compile.
+ * @param[in] sourceSize The amount of nibbles in the source.
+ * @param[in] packed Whether or not the source is packed, with two nibbles in each byte.
+ * @param[in, out] result The compiled operations, followed by an OP_END operation. A previous array is reused, and
+ * the array is freed if the program is rejected.
+ * @param[out] resultSize The amount of compiled operations, without the OP_END operation.
+ * @param[out] statistics The amount of loops that were replaced, or NULL.
+ * @param[out] errorIndex The input index of the loop that is unbalanced, if any.
+ *
+ * @return NIB_OK, or the reason why the program was rejected.
+ */
+static enum NIB_STATUS compileNibbles(const uint8_t* source, const size_t sourceSize, const bool packed, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex) {
+    struct Chunk chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    chunk.end = sourceSize;
+    chunk.program = *result;
+
+    const enum NIB_STATUS status = compileRange(source, packed, &chunk, false, errorIndex);
+    *result = chunk.program;
+    if(status != NIB_OK)
+        return status;
 
-            if (*inputIndex == inputSize)
-                error("Expected end of loop");
+    if(statistics != NULL)
+        addStatistics(statistics, &chunk.statistics);
+
+    if(chunk.openStartCount > 0) {
+        *errorIndex = (*result + *(chunk.openStarts + chunk.openStartCount - 1))->inputIndex;
+
+        freeAll(UINT32, 1, &chunk.openStarts);
+        freeAll(OPERATION, 1, result);
+        return NIB_ERROR_EXPECTED_LOOP_END;
+    }
+    free(chunk.openStarts);
+
+    return finishProgram(result, chunk.size, sourceSize, resultSize);
+}
+
+void moveOperations(struct Operation* destination, const struct Operation* source, const uint32_t count, const uint32_t distance) {
+    memcpy(destination, source, count * sizeof(struct Operation));
+
+    for(struct Operation* operation = destination; operation < destination + count; ++operation) {
+        switch(operation->type) {
+            case OP_LOOP_START:
+            case OP_LOOP_END:
+            case OP_MULTIPLY:
+            case OP_SCAN:
+            case OP_RANGE:
+                operation->jump += distance;
+                break;
+            default:
+                break;
         }
+    }
+}
 
-        // Keep any changes made to the input index.
-        if(!inputIndexChanged)
-            ++(*inputIndex);
+enum NIB_STATUS compileChunk(const uint8_t* source, const bool packed, struct Chunk* chunk) {
+    uint64_t errorIndex = 0;
+    return compileRange(source, packed, chunk, true, &errorIndex);
+}
+
+/**
+ * Frees the operations and the loop indexes of chunks.
+ *
+ * @param[in, out] chunks The chunks.
+ * @param[in] chunkCount The amount of chunks.
+ */
+static void freeChunks(struct Chunk* chunks, const uint32_t chunkCount) {
+    for(uint32_t i = 0; i < chunkCount; ++i) {
+        freeAll(OPERATION, 1, &(chunks + i)->program);
+        freeAll(UINT32, 2, &(chunks + i)->openStarts, &(chunks + i)->openEnds);
     }
 }
 
-void interpretSafely(const uint32_t memStepSize, uint8_t** inputData, const int32_t inputSize, uint32_t* inputIndex, uint8_t** data, uint32_t* dataIndex, uint32_t* dataSize, uint32_t** loopStack, uint32_t* loopStackIndex, uint32_t* loopStackSize) {
-    while(*inputIndex < inputSize) {
-        uint8_t instruction;
-        bool skipLoop = false;
-        bool inputIndexChanged = false;
+enum NIB_STATUS mergeChunks(struct Chunk* chunks, const uint32_t chunkCount, const size_t sourceSize, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex) {
+    uint64_t totalSize = 0;
+    size_t totalStarts = 0;
+    enum NIB_STATUS status = NIB_OK;
+
+    for(uint32_t i = 0; i < chunkCount; ++i) {
+        const struct Chunk* chunk = chunks + i;
+        if(chunk->status != NIB_OK && status == NIB_OK)
+            status = chunk->status;
+
+        totalSize += chunk->size;
+        totalStarts += chunk->openStartCount;
+    }
+
+    // Every loop start that is matched by another chunk is kept until its end is found.
+    uint32_t* openLoops = (uint32_t*) malloc(totalStarts > 0 ? totalStarts * sizeof(uint32_t) : 1);
+    size_t openLoopCount = 0;
+    uint32_t resultLimit = 0;
+
+    if(status == NIB_OK && totalSize > NIB_PROGRAM_LIMIT)
+        status = NIB_ERROR_TOO_LARGE;
+    if(status == NIB_OK && (openLoops == NULL || !reserveOperations(result, &resultLimit, (uint32_t) totalSize + NIB_INSERT_LIMIT + 2)))
+        status = NIB_ERROR_MEMORY;
+
+    if(status != NIB_OK) {
+        free(openLoops);
+        freeChunks(chunks, chunkCount);
+        freeAll(OPERATION, 1, result);
+        return status;
+    }
+
+    uint32_t size = 0;
+    // The amount of operations in the copies of balanced loops, which is the amount copied in each chunk plus this.
+    uint32_t copyOffset = 0;
+
+    for(uint32_t i = 0; i < chunkCount && status == NIB_OK; ++i) {
+        struct Chunk* chunk = chunks + i;
+        size_t nextStart = 0;
+        uint32_t cursor = 0;
+
+        if(statistics != NULL)
+            addStatistics(statistics, &chunk->statistics);
+
+        // Copy the operations up to every loop end that is matched here, and then match it like compile() does.
+        for(size_t nextEnd = 0; nextEnd <= chunk->openEndCount; ++nextEnd) {
+            const uint32_t segmentEnd = nextEnd < chunk->openEndCount ? *(chunk->openEnds + nextEnd) : chunk->size;
+
+            if((uint64_t) size + (segmentEnd - cursor) > NIB_PROGRAM_LIMIT) {
+                status = NIB_ERROR_TOO_LARGE;
+                break;
+            }
+            if(!reserveOperations(result, &resultLimit, size + (segmentEnd - cursor) + NIB_INSERT_LIMIT + 2)) {
+                status = NIB_ERROR_MEMORY;
+                break;
+            }
+
+            moveOperations(*result + size, chunk->program + cursor, segmentEnd - cursor, size - cursor);
 
-        // Parse the instruction safely.
-        instruction = *(*inputData + *inputIndex);
-        parseInstructionSafely(instruction, memStepSize, inputIndex, data, dataIndex, dataSize, loopStack, loopStackIndex, loopStackSize, &skipLoop, &inputIndexChanged);
+            // The loop starts that are matched later keep the amount of operations that were copied before them.
+            for(; nextStart < chunk->openStartCount && *(chunk->openStarts + nextStart) < segmentEnd; ++nextStart) {
+                const uint32_t index = *(chunk->openStarts + nextStart);
+                const uint32_t start = size + (index - cursor);
+
+                (*result + start)->jump = (chunk->program + index)->jump + copyOffset;
+                *(openLoops + openLoopCount++) = start;
+            }
+            size += segmentEnd - cursor;
 
-        // Skip the loop.
-        if(skipLoop) {
-            uint32_t loopCount = 1;
+            if(nextEnd == chunk->openEndCount)
+                break;
 
-            while (loopCount > 0 && *inputIndex < inputSize) {
-                instruction = *(*inputData + ++(*inputIndex));
+            struct Operation* operation = *result + size;
+            *operation = *(chunk->program + segmentEnd);
+            cursor = segmentEnd + 1;
 
-                if (instruction == NIB_LOOP_START)
-                    ++loopCount;
-                else if (instruction == NIB_LOOP_END)
-                    --loopCount;
+            if(openLoopCount == 0) {
+                *errorIndex = operation->inputIndex;
+                status = NIB_ERROR_UNEXPECTED_LOOP_END;
+                break;
             }
 
-            if (*inputIndex == inputSize)
-                error("Expected end of loop");
+            const uint32_t start = *(openLoops + --openLoopCount);
+            operation->count = (int32_t) (size - start - (copyOffset + operation->jump - (*result + start)->jump));
+            operation->jump = start;
+            (*result + start)->jump = size;
+
+            const uint32_t end = size;
+            size = optimizeLoop(*result, start, end, statistics);
+            if((*result + start)->type == OP_RANGE)
+                copyOffset += size - end - 1;
         }
 
-        // Keep any changes made to the input index.
-        if(!inputIndexChanged)
-            ++(*inputIndex);
+        copyOffset += chunk->copySize;
+        freeAll(OPERATION, 1, &chunk->program);
+        freeAll(UINT32, 2, &chunk->openStarts, &chunk->openEnds);
+    }
+
+    if(status == NIB_OK && openLoopCount > 0) {
+        *errorIndex = (*result + *(openLoops + openLoopCount - 1))->inputIndex;
+        status = NIB_ERROR_EXPECTED_LOOP_END;
+    }
+    free(openLoops);
+
+    if(status != NIB_OK) {
+        freeChunks(chunks, chunkCount);
+        freeAll(OPERATION, 1, result);
+        return status;
     }
+    return finishProgram(result, size, sourceSize, resultSize);
 }
 
-void parseInstruction(const uint8_t instruction, const uint32_t memStepSize, uint8_t** inputData, uint32_t* inputIndex, uint8_t** data, uint32_t* dataIndex, uint32_t* dataSize, uint32_t** loopStack, uint32_t* loopStackIndex, uint32_t* loopStackSize, bool* skipLoop, bool* inputIndexChanged) {
-    switch(instruction) {
-        case NIB_INCREMENT_POINTER: {
-            ++(*dataIndex);
-            if(*dataIndex == *dataSize) {
-                *data = ((uint8_t *) realloc(*data, (*dataSize += memStepSize)));
-                memset(*data + *dataSize - memStepSize, 0, memStepSize);
+enum NIB_STATUS linkChunks(struct Chunk* chunks, const uint32_t chunkCount, const size_t sourceSize, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex) {
+    size_t totalStarts = 0;
+    for(uint32_t i = 0; i < chunkCount; ++i)
+        totalStarts += (chunks + i)->openStartCount;
+
+    uint32_t* openLoops = (uint32_t*) malloc(totalStarts > 0 ? totalStarts * sizeof(uint32_t) : 1);
+    size_t openLoopCount = 0;
+    enum NIB_STATUS status = openLoops != NULL ? NIB_OK : NIB_ERROR_MEMORY;
+
+    uint32_t offset = 0;
+    uint32_t copyOffset = 0;
+
+    for(uint32_t i = 0; i < chunkCount && status == NIB_OK; ++i) {
+        struct Chunk* chunk = chunks + i;
+
+        if(statistics != NULL)
+            addStatistics(statistics, &chunk->statistics);
+
+        // The jumps of the loops that are matched here were moved by the offset of the chunk, but they keep the
+        // amount of operations that were copied before them. Loops that are matched here are never replaced.
+        for(size_t nextEnd = 0; nextEnd < chunk->openEndCount; ++nextEnd) {
+            const uint32_t end = offset + *(chunk->openEnds + nextEnd);
+            struct Operation* operation = *result + end;
+
+            if(openLoopCount == 0) {
+                *errorIndex = operation->inputIndex;
+                status = NIB_ERROR_UNEXPECTED_LOOP_END;
+                break;
             }
+
+            const uint32_t start = *(openLoops + --openLoopCount);
+            operation->count = (int32_t) (end - start - (copyOffset + operation->jump - offset - (*result + start)->jump));
+            operation->jump = start;
+            (*result + start)->jump = end;
+        }
+
+        for(size_t nextStart = 0; nextStart < chunk->openStartCount; ++nextStart) {
+            const uint32_t start = offset + *(chunk->openStarts + nextStart);
+
+            (*result + start)->jump += copyOffset - offset;
+            *(openLoops + openLoopCount++) = start;
+        }
+
+        offset += chunk->size;
+        copyOffset += chunk->copySize;
+    }
+
+    if(status == NIB_OK && openLoopCount > 0) {
+        *errorIndex = (*result + *(openLoops + openLoopCount - 1))->inputIndex;
+        status = NIB_ERROR_EXPECTED_LOOP_END;
+    }
+    free(openLoops);
+    freeChunks(chunks, chunkCount);
+
+    if(status != NIB_OK) {
+        freeAll(OPERATION, 1, result);
+        return status;
+    }
+    return finishProgram(result, offset, sourceSize, resultSize);
+}
+
+enum NIB_STATUS compile(const uint8_t* source, const size_t sourceSize, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex) {
+    return compileNibbles(source, sourceSize, false, result, resultSize, statistics, errorIndex);
+}
+
+enum NIB_STATUS compilePacked(const uint8_t* source, const size_t sourceSize, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex) {
+    return compileNibbles(source, sourceSize * 2, true, result, resultSize, statistics, errorIndex);
+}
+
+void interpret(nib_vm* vm) {
+    const uint32_t programSize = vm->programSize;
+    uint32_t programIndex = vm->programIndex;
+    size_t dataIndex = vm->dataIndex;
+
+    // Parse the operation, and move past it or past the loop operation that was jumped to.
+    while(programIndex < programSize && parseInstruction(vm->program + programIndex, vm, &programIndex, &dataIndex))
+        ++programIndex;
+
+    vm->programIndex = programIndex;
+    vm->dataIndex = dataIndex;
+}
+
+void interpretSafely(nib_vm* vm) {
+    const uint32_t programSize = vm->programSize;
+    uint32_t programIndex = vm->programIndex;
+    size_t dataIndex = vm->dataIndex;
+
+    // Parse the operation safely, and move past it or past the loop operation that was jumped to.
+    while(programIndex < programSize && parseInstructionSafely(vm->program + programIndex, vm, &programIndex, &dataIndex))
+        ++programIndex;
+
+    vm->programIndex = programIndex;
+    vm->dataIndex = dataIndex;
+}
+
+bool parseInstruction(const struct Operation* operation, nib_vm* vm, uint32_t* programIndex, size_t* dataIndex) {
+    struct Tape* tape = &vm->tape;
+
+    switch(operation->type) {
+        case OP_MOVE: {
+#ifdef NIB_GUARD_PAGES
+            // Invalid data indexes are caught by the guard pages, so nothing is checked here.
+            tape->operation = operation;
+            *dataIndex += operation->count;
+#else
+            size_t previousIndex = *dataIndex;
+            *dataIndex += operation->count;
+
+            // Only grow if the move went past the end, and not if it's still at a negative index.
+            if(operation->count > 0 && *dataIndex >= tape->size && (previousIndex < tape->size || *dataIndex < previousIndex) && !growTape(tape, *dataIndex))
+                raiseError(vm, NIB_ERROR_MEMORY, operation->inputIndex);
+#endif
             break;
         }
-        case NIB_DECREMENT_POINTER: {
-            --(*dataIndex);
+        case OP_ADD: {
+#ifndef NIB_GUARD_PAGES
+            if(*dataIndex >= tape->size)
+                raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, operation->inputIndex);
+#endif
+            *(tape->cells + *dataIndex + operation->offset) += (uint8_t) operation->count;
             break;
         }
-        case NIB_INCREMENT_VALUE: {
-            if(*dataIndex >= *dataSize) {
-                freeAll(UINT8, 2, data, inputData);
-                freeAll(UINT32, 1, loopStack);
-                error("Data index out of bounds at input index '%u'", *inputIndex);
-            }
-            ++(*(*data + *dataIndex));
+        case OP_WRITE: {
+#ifndef NIB_GUARD_PAGES
+            if(*dataIndex >= tape->size)
+                raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, operation->inputIndex);
+#endif
+            writeValue(vm, *(tape->cells + *dataIndex + operation->offset));
             break;
         }
-        case NIB_DECREMENT_VALUE: {
-            if(*dataIndex >= *dataSize) {
-                freeAll(UINT8, 2, data, inputData);
-                freeAll(UINT32, 1, loopStack);
-                error("Data index out of bounds at input index '%u'", *inputIndex);
-            }
-            --(*(*data + *dataIndex));
+        case OP_READ: {
+#ifndef NIB_GUARD_PAGES
+            if(*dataIndex >= tape->size)
+                raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, operation->inputIndex);
+#endif
+            *(tape->cells + *dataIndex + operation->offset) = (uint8_t) readValue(vm);
             break;
         }
-        case NIB_WRITE_VALUE: {
-            if(*dataIndex >= *dataSize) {
-                freeAll(UINT8, 2, data, inputData);
-                freeAll(UINT32, 1, loopStack);
-                error("Data index out of bounds at input index '%u'", *inputIndex);
-            }
-            putchar(*(*data + *dataIndex));
+        case OP_LOOP_START: {
+#ifndef NIB_GUARD_PAGES
+            if(*dataIndex >= tape->size)
+                raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, operation->inputIndex);
+#endif
+            // Jump to the end of the loop, and skip it.
+            if(*(tape->cells + *dataIndex) == 0)
+                *programIndex = operation->jump;
             break;
         }
-        case NIB_READ_VALUE: {
-            if(*dataIndex >= *dataSize) {
-                freeAll(UINT8, 2, data, inputData);
-                freeAll(UINT32, 1, loopStack);
-                error("Data index out of bounds at input index '%u'", *inputIndex);
+        case OP_LOOP_END: {
+#ifndef NIB_GUARD_PAGES
+            if(*dataIndex >= tape->size)
+                raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, operation->inputIndex);
+#endif
+            // Jump to the start of the loop, and skip it as its check would pass anyway. Stop before repeating
+            // the loop if there are not enough steps left.
+            if(*(tape->cells + *dataIndex) != 0) {
+                if(vm->steps < (uint32_t) operation->count)
+                    return false;
+
+                vm->steps -= (uint32_t) operation->count;
+                *programIndex = operation->jump;
             }
-            *(*data + *dataIndex) = getchar();
             break;
         }
-        case NIB_LOOP_START: {
-            if(*(*data + *dataIndex) == 0) {
-                *skipLoop = true;
-            } else {
-                ++(*loopStackIndex);
-                if(*loopStackIndex == *loopStackSize) {
-                    *loopStack = ((uint32_t *) realloc(*loopStack, (*loopStackSize += memStepSize) * 4)) + *loopStackIndex;
-                    memset(*loopStack + *loopStackSize - memStepSize, 0, memStepSize);
-                }
-                *(*loopStack + *loopStackIndex) = *inputIndex;
-            }
+        case OP_CLEAR: {
+#ifndef NIB_GUARD_PAGES
+            if(*dataIndex >= tape->size)
+                raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, operation->inputIndex);
+#endif
+            *(tape->cells + *dataIndex + operation->offset) = 0;
             break;
         }
-        case NIB_LOOP_END: {
-            if(*loopStackIndex >= *loopStackSize) {
-                freeAll(UINT8, 2, data, inputData);
-                freeAll(UINT32, 1, loopStack);
-                error("Unexpected end of loop at input index '%u'", *inputIndex);
-            }
-            *inputIndex = *((*loopStack + (*loopStackIndex)--));
-            *inputIndexChanged = true;
+        case OP_MULTIPLY: {
+            // Skip the loop, or the multiplications if the loop must be interpreted instead.
+            if(multiplyData(vm, operation, *dataIndex))
+                *programIndex = operation->jump;
+            else *programIndex += operation->count;
+            break;
+        }
+        case OP_SCAN: {
+            // Skip the loop, unless it must be interpreted instead.
+            if(scanData(vm, operation->count, dataIndex))
+                *programIndex = operation->jump;
+            break;
+        }
+        case OP_RANGE: {
+            // Skip the original loop, unless the copy can't be run.
+            if(checkRange(vm, operation, *dataIndex))
+                *programIndex = operation->jump;
             break;
         }
         default: {
             break;
         }
     }
+    return true;
 }
 
-void parseInstructionSafely(const uint8_t instruction, const uint32_t memStepSize, uint32_t* inputIndex, uint8_t** data, uint32_t* dataIndex, uint32_t* dataSize, uint32_t** loopStack, uint32_t* loopStackIndex, uint32_t* loopStackSize, bool* skipLoop, bool* inputIndexChanged) {
-    switch(instruction) {
-        case NIB_INCREMENT_POINTER: {
-            ++(*dataIndex);
-            if(*dataIndex == *dataSize) {
-                *data = ((uint8_t *) realloc(*data, (*dataSize += memStepSize)));
-                memset(*data + *dataSize - memStepSize, 0, memStepSize);
+bool parseInstructionSafely(const struct Operation* operation, nib_vm* vm, uint32_t* programIndex, size_t* dataIndex) {
+    struct Tape* tape = &vm->tape;
+
+    switch(operation->type) {
+        case OP_MOVE: {
+            if(operation->count < 0) {
+                // Moving to a negative index is ignored, so the data index stops at 0.
+                size_t distance = (size_t) -(int64_t) operation->count;
+                *dataIndex = distance > *dataIndex ? 0 : *dataIndex - distance;
+            } else {
+                *dataIndex += operation->count;
+#ifdef NIB_GUARD_PAGES
+                // Only moving past the end of the data array or past its memory limit is invalid here, which is
+                // cheaper to check than to record every move. The memory limit is never past the end.
+                if(*dataIndex >= tape->memoryLimit)
+                    raiseError(vm, *dataIndex >= tape->limit ? NIB_ERROR_OUT_OF_BOUNDS : NIB_ERROR_MEMORY_LIMIT, operation->inputIndex);
+#else
+                if(*dataIndex >= tape->size && !growTape(tape, *dataIndex))
+                    raiseError(vm, NIB_ERROR_MEMORY, operation->inputIndex);
+#endif
             }
             break;
         }
-        case NIB_DECREMENT_POINTER: {
-            if(*dataIndex < *dataSize)
-                --(*dataIndex);
+        case OP_ADD: {
+            // No check needed, as the data index will never be out of bounds.
+            *(tape->cells + *dataIndex + operation->offset) += (uint8_t) operation->count;
             break;
         }
-        case NIB_INCREMENT_VALUE: {
+        case OP_WRITE: {
             // No check needed, as the data index will never be out of bounds.
-            ++(*(*data + *dataIndex));
+            writeValue(vm, *(tape->cells + *dataIndex + operation->offset));
             break;
         }
-        case NIB_DECREMENT_VALUE: {
+        case OP_READ: {
             // No check needed, as the data index will never be out of bounds.
-            --(*(*data + *dataIndex));
+            *(tape->cells + *dataIndex + operation->offset) = (uint8_t) readValue(vm);
             break;
         }
-        case NIB_WRITE_VALUE: {
-            // No check needed, as the data index will never be out of bounds.
-            putchar(*(*data + *dataIndex));
+        case OP_LOOP_START: {
+            // Jump to the end of the loop, and skip it.
+            if(*(tape->cells + *dataIndex) == 0)
+                *programIndex = operation->jump;
             break;
         }
-        case NIB_READ_VALUE: {
+        case OP_LOOP_END: {
+            // Jump to the start of the loop, and skip it as its check would pass anyway. Stop before repeating
+            // the loop if there are not enough steps left.
+            if(*(tape->cells + *dataIndex) != 0) {
+                if(vm->steps < (uint32_t) operation->count)
+                    return false;
+
+                vm->steps -= (uint32_t) operation->count;
+                *programIndex = operation->jump;
+            }
+            break;
+        }
+        case OP_CLEAR: {
             // No check needed, as the data index will never be out of bounds.
-            *(*data + *dataIndex) = getchar();
+            *(tape->cells + *dataIndex + operation->offset) = 0;
             break;
         }
-        case NIB_LOOP_START: {
-            if(*(*data + *dataIndex) == 0) {
-                *skipLoop = true;
-            } else {
-                ++(*loopStackIndex);
-                if(*loopStackIndex == *loopStackSize) {
-                    *loopStack = ((uint32_t *) realloc(*loopStack, (*loopStackSize += memStepSize) * 4)) + *loopStackIndex;
-                    memset(*loopStack + *loopStackSize - memStepSize, 0, memStepSize);
-                }
-                *(*loopStack + *loopStackIndex) = *inputIndex;
-            }
+        case OP_MULTIPLY: {
+            // Skip the loop, or the multiplications if the loop must be interpreted instead.
+            if(multiplyData(vm, operation, *dataIndex))
+                *programIndex = operation->jump;
+            else *programIndex += operation->count;
             break;
         }
-        case NIB_LOOP_END: {
-            if(*loopStackIndex < *loopStackSize) {
-                *inputIndex = *((*loopStack + (*loopStackIndex)--));
-                *inputIndexChanged = true;
-            }
+        case OP_SCAN: {
+            // Skip the loop, unless it must be interpreted instead.
+            if(scanData(vm, operation->count, dataIndex))
+                *programIndex = operation->jump;
+            break;
+        }
+        case OP_RANGE: {
+            // Skip the original loop, unless the copy can't be run.
+            if(checkRange(vm, operation, *dataIndex))
+                *programIndex = operation->jump;
             break;
         }
         default: {
             break;
         }
     }
-}
\ No newline at end of file
+    return true;
+}
@@ -32,6 +32,8 @@
 #include <string.h>
 #include <stdbool.h>
 
+#include "libnib.h"
+
 // If you use this header in a larger project, you should replace all #define preprocessor directives
 // with something like const uint8_t, as it's better practice to do that. However, #define works just
 // fine here, as this is not a large project.
@@ -52,25 +54,304 @@
 #define NIB_LOOP_START 0b0100u
 #define NIB_LOOP_END 0b0001u
 
+// Nibbles that have this bit set are not instructions, and are only used for padding.
+#define NIB_PADDING_BIT 0b1000u
+
+// The maximum amount of values that a loop can change in order to be replaced with multiplications.
+#define NIB_MULTIPLY_LIMIT 16u
+// The maximum amount of operations inside a balanced loop in order to be copied without its moves.
+#define NIB_BALANCED_LIMIT 64u
+// The maximum amount of operations inserted when a loop is replaced, which is the most for balanced loops.
+#define NIB_INSERT_LIMIT (NIB_BALANCED_LIMIT + 2)
+
+// On 64-bit systems that support it, the data array is a large reserved region of memory which is surrounded by
+// guard pages, and whose pages are committed when they are first used. Invalid data indexes are then caught by the
+// hardware, so the interpreters don't need to check them. Define NIB_NO_GUARD_PAGES to always check them instead.
+#if !defined(NIB_NO_GUARD_PAGES) && UINTPTR_MAX > UINT32_MAX && (defined(__unix__) || defined(__APPLE__) || defined(_WIN32))
+#define NIB_GUARD_PAGES
+#endif
+
+// With guard pages, this is the largest region that can be reserved for the data array, in bytes, which is 64 GiB
+// unless NIB_TAPE_BITS is defined. Every data array reserves its own size, from its options. Otherwise, data indexes
+// from this one onwards are out of bounds, and it's where the negative data indexes start.
+#ifdef NIB_GUARD_PAGES
+#ifndef NIB_TAPE_BITS
+#define NIB_TAPE_BITS 36u
+#endif
+#define NIB_TAPE_LIMIT ((size_t) 1 << NIB_TAPE_BITS)
+#else
+#define NIB_TAPE_LIMIT (SIZE_MAX / 2 + 1)
+#endif
+
+// The paged data array is split into pages of 64 KiB unless NIB_PAGE_BITS is defined, which are found through a
+// two-level page table. Both levels have the same amount of entries, so 1 TiB can be used on 64-bit systems.
+#ifndef NIB_PAGE_BITS
+#define NIB_PAGE_BITS 16u
+#endif
+#if UINTPTR_MAX > UINT32_MAX
+#define NIB_PAGE_TABLE_BITS 12u
+#else
+#define NIB_PAGE_TABLE_BITS 7u
+#endif
+#define NIB_PAGE_SIZE ((size_t) 1 << NIB_PAGE_BITS)
+// Data indexes from this one onwards are out of bounds for the paged data array.
+#define NIB_PAGED_LIMIT ((size_t) 1 << (NIB_PAGE_BITS + 2 * NIB_PAGE_TABLE_BITS))
+
+// The maximum amount of values and of output bytes that a precomputed snapshot can hold.
+#define NIB_SNAPSHOT_LIMIT ((size_t) 1 << 24)
+
+// Scripts are only compiled on several threads in chunks of at least 1 MiB, as smaller ones load faster on one.
+#define NIB_CHUNK_SIZE ((size_t) 1 << 20)
+
+// The maximum amount of operations in a compiled program, whose indexes are 32-bit.
+#define NIB_PROGRAM_LIMIT (UINT32_MAX - NIB_INSERT_LIMIT - 2)
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define NIB_THREAD_LOCAL __declspec(thread)
+#else
+#define NIB_THREAD_LOCAL _Thread_local
+#endif
+
+// The cancel flag of a virtual machine is set from other threads. The compiler of Microsoft only has the interlocked
+// functions for that.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define NIB_ATOMIC_FLAG volatile long
+#else
+#include <stdatomic.h>
+#define NIB_ATOMIC_FLAG atomic_bool
+#endif
+
 /**
  * Represents a type of pointer.
  */
-enum POINTER_TYPE { CHAR, UINT8, UINT32 };
+enum POINTER_TYPE { CHAR, UINT8, UINT32, OPERATION };
+
+/**
+ * Represents a type of compiled operation.
+ */
+enum OPERATION_TYPE { OP_ADD, OP_MOVE, OP_WRITE, OP_READ, OP_LOOP_START, OP_LOOP_END, OP_END, OP_CLEAR, OP_MULTIPLY, OP_MULTIPLY_ADD, OP_SCAN, OP_RANGE };
 
 /**
- * Writes an error to STDERR and terminates the program with the status code 1.
+ * Represents a compiled operation.
+ *
+ * Runs of INCREMENT_VALUE and DECREMENT_VALUE are folded into a single OP_ADD, and runs of INCREMENT_POINTER
+ * or DECREMENT_POINTER are folded into a single OP_MOVE. The count is the signed amount to add or move by. Moves
+ * that follow each other never go further than a signed 32-bit count in total, as an OP_ADD with a count of 0 is
+ * put between them otherwise.
+ *
+ * Loop operations are matched when compiling, and the jump is the index of the matching loop operation. The count
+ * of an OP_LOOP_END is the amount of operations from its OP_LOOP_START to itself, which is the amount of steps
+ * that every repetition of the loop counts as.
+ *
+ * Compiled programs always end with an OP_END operation, which stops the threaded interpreters.
+ *
+ * Some common loops are replaced with faster operations:
  *
- * @param[in] format The format of the error.
- * @param[in] ... The additional arguments for the error format.
+ * - [-] becomes an OP_CLEAR, which sets the value to 0.
+ * - [->+>++<<] is preceded by an OP_MULTIPLY and one OP_MULTIPLY_ADD for every other value that the loop changes.
+ *   The count of the OP_MULTIPLY is the amount of OP_MULTIPLY_ADD operations, and its offset is the lowest offset
+ *   that the loop moves to. Each OP_MULTIPLY_ADD adds the current value, multiplied by its count, to the value at
+ *   its offset, and they are sorted by offset.
+ * - [>] is preceded by an OP_SCAN, whose count is the amount to move by until a value of 0 is found.
+ * - [->+<.] and other loops without nested loops whose moves cancel out are preceded by an OP_RANGE, and followed
+ *   by a copy of the loop without its moves. The other operations of the copy use the value at their offset from
+ *   the data index, which never changes inside the copy. The offset of the OP_RANGE is the lowest offset that the
+ *   loop moves to, and its count is the highest one, so that checking both once is enough for every repetition.
+ *
+ * The OP_MULTIPLY, OP_SCAN and OP_RANGE operations jump to the end of the original loop, which is kept right after
+ * them and is only run when the faster operation can't be used (e.g. the loop would move to a negative index).
+ * Only the operations of the copy of a balanced loop have offsets, and its loop end counts as many steps as the
+ * original one.
  */
-void error(const char* format, ...);
+struct Operation {
+    uint8_t type;
+    int32_t count;
+    int32_t offset;
+    uint32_t jump;
+    // The index of the first decoded nibble of this operation, used when reporting errors.
+    uint64_t inputIndex;
+};
+
 /**
- * Closes all given FILE pointers.
+ * Represents a range of nibbles that is compiled on its own, so that large programs can be compiled on several
+ * threads.
  *
- * @param[in] count The amount of given FILE pointers..
- * @param[in, out] ... The FILE pointers.
+ * Chunks never split a run of operations that would be folded together. The loops that start and end inside a
+ * chunk are matched and replaced like in a whole program, and the others are matched when the chunks are merged.
+ */
+struct Chunk {
+    // The range of nibbles to compile.
+    size_t start;
+    size_t end;
+    // The compiled operations, without an OP_END operation. Their jumps are indexes inside the chunk.
+    struct Operation* program;
+    uint32_t size;
+    // The indexes of the loop starts and ends that are matched in other chunks, in order. Their jump is the amount
+    // of operations that were copied in the chunk before them.
+    uint32_t* openStarts;
+    size_t openStartCount;
+    uint32_t* openEnds;
+    size_t openEndCount;
+    // The amount of operations in the copies of balanced loops.
+    uint32_t copySize;
+    // The amount of loops that were replaced.
+    struct IdiomStatistics statistics;
+    // NIB_OK, or the reason why the chunk could not be compiled.
+    enum NIB_STATUS status;
+};
+
+/**
+ * Represents a buffered stream of bytes.
+ */
+struct Buffer {
+    uint8_t* bytes;
+    // The amount of bytes in the buffer.
+    uint32_t size;
+    // The index of the next byte to read, used by the input buffer.
+    uint32_t index;
+    // The capacity of the buffer, in bytes.
+    uint32_t limit;
+};
+
+/**
+ * Represents the data array.
  */
-void closeAll(uint32_t count, ...);
+struct Tape {
+    // The values, which are cellSize bytes wide. The interpreters cast them to the type of their width.
+    uint8_t* cells;
+    // The size of every value, in bytes.
+    uint32_t cellSize;
+    // The amount of values that can be used without growing the data array.
+    size_t size;
+    // The amount of values to add when growing the data array, rounded up to whole pages when guard pages are used.
+    uint32_t stepSize;
+    // The last OP_MOVE that was run by the unsafe interpreters. Invalid data indexes are only reached by moving,
+    // so the operation right after it is the one that used the invalid data index.
+    const struct Operation* volatile operation;
+    // The page directory of the paged data array, or NULL if the data array is contiguous. Its page tables and
+    // pages are allocated when they are first used. The cells then point to where data index 0 would be if it was
+    // on the current page, so that the values of the current page are still at cells + index.
+    uint8_t*** pages;
+    // The data index of the first value of the current page.
+    size_t pageStart;
+    // The amount of values in the pages that were allocated.
+    size_t pageValues;
+    // The maximum amount of values that the data array can hold, so that it stays inside its memory limit.
+    size_t memoryLimit;
+    // Whether or not the data array could not grow because of its memory limit, in which case running out of
+    // memory is reported as NIB_ERROR_MEMORY_LIMIT.
+    bool limitReached;
+#ifdef NIB_GUARD_PAGES
+    // The reserved region, which contains the data array and its guards.
+    uint8_t* region;
+    // Data indexes from this one onwards are out of bounds. It's a power of two.
+    size_t limit;
+    // The amount of values in the reserved region, which is a power of two. It's the limit, unless only enough for
+    // the memory limit was reserved. Data indexes past it are caught by the guard after it.
+    size_t reserved;
+#endif
+};
+
+/**
+ * Represents the machine code that the JIT generated for a program.
+ */
+struct JitProgram;
+
+/**
+ * Represents what a virtual machine counted while running with the profiler.
+ */
+struct Profile {
+    // The amount of times that every operation was run, including the OP_END operation.
+    uint64_t* executions;
+    // The amount of steps that were taken.
+    uint64_t steps;
+    // The highest data index that was moved to.
+    size_t maxDataIndex;
+    // The time spent writing the output and reading the input, in seconds.
+    double ioSeconds;
+};
+
+/**
+ * Represents the state that a program reaches when it's run at load time without any input, up to its first read or
+ * until its precomputed steps run out. Runs start from this state instead of from the start of the program.
+ */
+struct Snapshot {
+    // The index of the operation to resume from, which is never inside the copy of a balanced loop.
+    uint32_t programIndex;
+    size_t dataIndex;
+    // The amount of steps that were taken.
+    uint64_t steps;
+    // The amount of values that were used, which the data array must hold so that it's just like after those steps.
+    size_t usedValues;
+    // The values up to the last one that is not 0, which are cellSize bytes wide.
+    const uint8_t* cells;
+    size_t cellCount;
+    // The output that was written, which the first run writes at once.
+    const uint8_t* output;
+    size_t outputSize;
+    // The memory that holds the values and the output, or NULL if they are mapped from a cache file.
+    uint8_t* memory;
+};
+
+/**
+ * Represents a virtual machine.
+ */
+struct nib_vm {
+    struct NibOptions options;
+    struct NibIo io;
+
+    // The compiled program, followed by an OP_END operation.
+    struct Operation* program;
+    // The amount of operations, without the OP_END operation.
+    uint32_t programSize;
+    // The cache file that the program was mapped from, or NULL if the program was allocated.
+    void* programMapping;
+    // The size of the mapped cache file, in bytes.
+    size_t programMappingSize;
+    // The index of the next operation to run.
+    uint32_t programIndex;
+    // The amount of loops that were replaced when compiling.
+    struct IdiomStatistics idioms;
+    // The amount of steps that the largest loop takes for every repetition. Runs take at least this many steps,
+    // so that they always make progress.
+    uint32_t loopSteps;
+    // The machine code of the program, which is generated by the first run that uses the JIT.
+    struct JitProgram* jit;
+    // What the profiler counted since the last reset, or NULL if the profiler is not used.
+    struct Profile* profile;
+    // The state that runs start from, or NULL if the program was not precomputed.
+    struct Snapshot* snapshot;
+    // Whether or not the output of the snapshot was not written yet since the last reset.
+    bool snapshotPending;
+
+    struct Tape tape;
+    size_t dataIndex;
+
+    // The buffered output and input.
+    struct Buffer output;
+    struct Buffer input;
+    // Whether or not the input has ended, after which every read returns EOF.
+    bool inputEnded;
+
+    // The amount of steps that the current slice of the run can still take, and after the run, the amount of steps
+    // that the whole run had left.
+    uint64_t steps;
+    // Whether or not nibCancel() was called since the last cancelled run.
+    NIB_ATOMIC_FLAG cancelled;
+    // NIB_OK if the program can be run, or the error that stopped it.
+    enum NIB_STATUS status;
+    // The input index of the last error.
+    uint64_t errorIndex;
+    // The jump buffer of the current run, which errors return to.
+    void* recovery;
+};
+
+// The virtual machine that is running on the current thread, if any, which is used when handling the guard pages.
+extern NIB_THREAD_LOCAL nib_vm* runningVm;
+
+// The I/O of the virtual machines that were created without one, which uses STDOUT and STDIN.
+extern const struct NibIo standardIo;
+
 /**
  * Frees all given pointers of the same type.
  *
@@ -79,90 +360,564 @@ void closeAll(uint32_t count, ...);
  * @param[int, out] ... The pointers.
  */
 void freeAll(enum POINTER_TYPE type, uint32_t count, ...);
+/**
+ * Stops the current run of a virtual machine because of an error, and returns from nibRun().
+ *
+ * @param[in, out] vm The running virtual machine.
+ * @param[in] status The error. NIB_ERROR_MEMORY becomes NIB_ERROR_MEMORY_LIMIT if the data array reached its limit.
+ * @param[in] inputIndex The input index of the error.
+ */
+_Noreturn void raiseError(nib_vm* vm, enum NIB_STATUS status, uint64_t inputIndex);
 
 /**
- * Sets up the interpreter for a FILE pointer and runs it.
+ * Drops the program of a virtual machine before another one is loaded. The operations are only freed if they were
+ * mapped from a cache file, so that the array can be reused otherwise.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void prepareLoad(nib_vm* vm);
+/**
+ * Finishes loading a program into a virtual machine, and resets the virtual machine.
+ *
+ * @param[in, out] vm The virtual machine, whose program was just compiled or mapped.
+ * @param[in] status NIB_OK, or the reason why the program could not be loaded.
  *
- * @param[in, out] input The pointer to the input FILE pointer.
- * @param[in] memStepSize The amount of extra memory to allocate for the data array and loops stack when they run out of it, in bytes.
- * @param[in] safe Whether or not to use the safe interpreter.
+ * @return NIB_OK, or the reason why the program could not be loaded.
+ */
+enum NIB_STATUS finishLoad(nib_vm* vm, enum NIB_STATUS status);
+/**
+ * Finds the amount of steps that the largest loop of the program of a virtual machine takes for every repetition.
  *
- * @note The input FILE* is passed by using a pointer because it will be modified inside this function (it will be closed).
+ * @param[in, out] vm The virtual machine, whose program was just compiled or mapped.
  */
-void run(FILE** input, uint32_t memStepSize, bool safe);
+void measureLoops(nib_vm* vm);
+/**
+ * Runs the program of a virtual machine from where it stopped, like nibRun(), but with a budget that was already
+ * worked out. After the run, the steps of the virtual machine are the ones that the budget has left.
+ *
+ * @param[in, out] vm The virtual machine, which can be run and has not reached the end of its program.
+ * @param[in] steps The maximum amount of steps to run for.
+ * @param[in] deadline The time at which the run stops, as given by profileClock(), if the run has a time limit.
+ *
+ * @return NIB_OK if the program ended, NIB_STEP_LIMIT, NIB_TIMEOUT or NIB_CANCELLED if it can be resumed, or the
+ * reason why it failed.
+ */
+enum NIB_STATUS runProgram(nib_vm* vm, uint64_t steps, double deadline);
+
 /**
  * Decodes an array of bytes to an interpretable format.
  *
+ * SSE2 or AVX2 is used when available, in which case many bytes are decoded at once.
+ *
  * @param[in] source The byte array source to decode.
  * @param[in] sourceSize The size of the source, in bytes.
- * @param[out] result The decoded source, as an array of bytes.
+ * @param[out] result The decoded source, as an array of bytes, or NULL if it could not be allocated.
  *
  * @return The size of the decoded source, in bytes.
  */
-uint32_t decode(const uint8_t* source, uint32_t sourceSize, uint8_t** result);
-
+size_t decode(const uint8_t* source, size_t sourceSize, uint8_t** result);
+/**
+ * Decodes a byte array into a buffer, which is done like in decode().
+ *
+ * @param[in] source The byte array source to decode.
+ * @param[in] sourceSize The size of the source, in bytes.
+ * @param[out] result The decoded source, which must be twice as large as the source.
+ */
+void decodeInto(const uint8_t* source, size_t sourceSize, uint8_t* result);
+/**
+ * Compiles an array of decoded nibbles to an array of operations.
+ *
+ * Padding nibbles are dropped, and runs of value or pointer instructions are folded into single operations.
+ * Loops are matched, and the program is rejected if they are unbalanced. Common loops are replaced with faster
+ * operations.
+ *
+ * @param[in] source The decoded source to compile.
+ * @param[in] sourceSize The size of the decoded source, in bytes.
+ * @param[in, out] result The compiled operations, followed by an OP_END operation. A previous array is reused, and
+ * the array is freed if the program is rejected.
+ * @param[out] resultSize The amount of compiled operations, without the OP_END operation.
+ * @param[out] statistics The amount of loops that were replaced, or NULL.
+ * @param[out] errorIndex The input index of the loop that is unbalanced, if any.
+ *
+ * @return NIB_OK, or the reason why the program was rejected.
+ */
+enum NIB_STATUS compile(const uint8_t* source, size_t sourceSize, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex);
+/**
+ * Compiles an array of packed nibbles to an array of operations, without decoding them first.
+ *
+ * @param[in] source The packed source to compile, with two nibbles in each byte.
+ * @param[in] sourceSize The size of the packed source, in bytes.
+ * @param[in, out] result The compiled operations, followed by an OP_END operation. A previous array is reused, and
+ * the array is freed if the program is rejected.
+ * @param[out] resultSize The amount of compiled operations, without the OP_END operation.
+ * @param[out] statistics The amount of loops that were replaced, or NULL.
+ * @param[out] errorIndex The input index of the loop that is unbalanced, if any.
+ *
+ * @return NIB_OK, or the reason why the program was rejected.
+ */
+enum NIB_STATUS compilePacked(const uint8_t* source, size_t sourceSize, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex);
+/**
+ * Copies operations to another array, and moves the jumps of their loops by the same distance.
+ *
+ * @param[out] destination The array to copy to.
+ * @param[in] source The operations to copy.
+ * @param[in] count The amount of operations to copy.
+ * @param[in] distance The distance to move the jumps by.
+ */
+void moveOperations(struct Operation* destination, const struct Operation* source, uint32_t count, uint32_t distance);
+/**
+ * Compiles a chunk of nibbles, which are either decoded or packed, to an array of operations.
+ *
+ * @param[in] source The whole source, either decoded or packed.
+ * @param[in] packed Whether or not the source is packed, with two nibbles in each byte.
+ * @param[in, out] chunk The range of nibbles to compile, whose other fields must be zeroed, and the result.
+ *
+ * @return NIB_OK, or the reason why the chunk could not be compiled.
+ */
+enum NIB_STATUS compileChunk(const uint8_t* source, bool packed, struct Chunk* chunk);
+/**
+ * Merges compiled chunks into a whole program, like the one that compile() gives for the same source, and frees
+ * them.
+ *
+ * @param[in, out] chunks The chunks, in order, which are freed.
+ * @param[in] chunkCount The amount of chunks.
+ * @param[in] sourceSize The amount of nibbles in the source.
+ * @param[in, out] result The compiled operations, followed by an OP_END operation. A previous array is reused, and
+ * the array is freed if the program is rejected.
+ * @param[out] resultSize The amount of compiled operations, without the OP_END operation.
+ * @param[out] statistics The amount of loops that were replaced, or NULL.
+ * @param[out] errorIndex The input index of the loop that is unbalanced, if any.
+ *
+ * @return NIB_OK, or the reason why the program was rejected.
+ */
+enum NIB_STATUS mergeChunks(struct Chunk* chunks, uint32_t chunkCount, size_t sourceSize, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex);
+/**
+ * Matches the loops between compiled chunks that were already moved into a whole program, one after the other,
+ * and frees the chunks.
+ *
+ * This is only the same as mergeChunks() if none of those loops would be replaced, which holds when every chunk
+ * after the first one starts with a loop that is not replaced with an OP_CLEAR operation.
+ *
+ * @param[in, out] chunks The chunks, in order, which were compiled without errors and are freed.
+ * @param[in] chunkCount The amount of chunks.
+ * @param[in] sourceSize The amount of nibbles in the source.
+ * @param[in, out] result The moved operations, with room for one more. The array is freed if the program is
+ * rejected.
+ * @param[out] resultSize The amount of compiled operations, without the OP_END operation.
+ * @param[out] statistics The amount of loops that were replaced, or NULL.
+ * @param[out] errorIndex The input index of the loop that is unbalanced, if any.
+ *
+ * @return NIB_OK, or the reason why the program was rejected.
+ */
+enum NIB_STATUS linkChunks(struct Chunk* chunks, uint32_t chunkCount, size_t sourceSize, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex);
 /**
- * Interprets an array of instructions.
+ * Decodes and compiles a script on several threads, like decode() and compile() or compilePacked() would.
  *
- * @param[in] memStepSize The amount of extra memory to allocate for the data array and loops stack when they run out of it, in bytes.
- * @param[in, out] inputData The input byte array to interpret.
- * @param[in] inputSize The size of the input
- * @param[in, out] inputIndex The index from which to interpret.
- * @param[in, out] data The data byte array.
+ * The script is split into chunks of at least NIB_CHUNK_SIZE bytes, which are decoded and compiled at once, and
+ * then merged, so there is only one chunk for smaller scripts. The chunks start at loops where possible, so that
+ * they are also moved into the program at once.
+ *
+ * @param[in] source The script.
+ * @param[in] sourceSize The size of the script, in bytes.
+ * @param[in] packed Whether or not to compile the chunks straight from the packed nibbles.
+ * @param[in] threadCount The amount of threads to use, including the calling thread.
+ * @param[in, out] result The compiled operations, followed by an OP_END operation. A previous array is reused, and
+ * the array is freed if the program is rejected.
+ * @param[out] resultSize The amount of compiled operations, without the OP_END operation.
+ * @param[out] statistics The amount of loops that were replaced, or NULL.
+ * @param[out] errorIndex The input index of the loop that is unbalanced, if any.
+ *
+ * @return NIB_OK, or the reason why the program was rejected.
+ */
+enum NIB_STATUS compileParallel(const uint8_t* source, size_t sourceSize, bool packed, uint32_t threadCount, struct Operation** result, uint32_t* resultSize, struct IdiomStatistics* statistics, uint64_t* errorIndex);
+/**
+ * Runs a multiplication loop, starting from its OP_MULTIPLY operation.
+ *
+ * @param[in, out] vm The running virtual machine.
+ * @param[in] operation The OP_MULTIPLY operation, followed by its OP_MULTIPLY_ADD operations.
+ * @param[in] dataIndex The data index.
+ *
+ * @return Whether or not the loop was run. If not, the original loop must be interpreted instead.
+ */
+bool multiplyData(nib_vm* vm, const struct Operation* operation, size_t dataIndex);
+/**
+ * Runs a scan loop, moving the data index until a value of 0 is found.
+ *
+ * @param[in, out] vm The running virtual machine.
+ * @param[in] step The amount to move by.
  * @param[in, out] dataIndex The data index.
- * @param[in, out] dataSize The size of the data.
- * @param[in, out] loopStack The loop stack.
- * @param[in, out] loopStackIndex The index of the loop stack.
- * @param[in, out] loopStackSize The size of the loop stack.
+ *
+ * @return Whether or not the loop was run. If not, the original loop must be interpreted instead.
+ */
+bool scanData(nib_vm* vm, int32_t step, size_t* dataIndex);
+/**
+ * Checks whether or not every value that a balanced loop moves to is valid, starting from its OP_RANGE operation.
+ * The data array is grown if needed.
+ *
+ * @param[in, out] vm The running virtual machine.
+ * @param[in] operation The OP_RANGE operation.
+ * @param[in] dataIndex The data index.
+ *
+ * @return Whether or not the copy of the loop can be run. If not, the original loop must be interpreted instead.
+ */
+bool checkRange(nib_vm* vm, const struct Operation* operation, size_t dataIndex);
+
+/**
+ * Runs a multiplication loop on a paged data array, starting from its OP_MULTIPLY operation.
+ *
+ * @param[in, out] vm The running virtual machine, whose data array is paged.
+ * @param[in] operation The OP_MULTIPLY operation, followed by its OP_MULTIPLY_ADD operations.
+ * @param[in] dataIndex The data index.
+ *
+ * @return Whether or not the loop was run. If not, the original loop must be interpreted instead.
  */
-void interpret(uint32_t memStepSize, uint8_t** inputData, int32_t inputSize, uint32_t* inputIndex, uint8_t** data, uint32_t* dataIndex, uint32_t* dataSize, uint32_t** loopStack, uint32_t* loopStackIndex, uint32_t* loopStackSize);
+bool multiplyPagedData(nib_vm* vm, const struct Operation* operation, size_t dataIndex);
 /**
- * Interprets an array of instructions safely.
+ * Runs a scan loop on a paged data array, moving the data index until a value of 0 is found.
+ *
+ * Pages that were never used are filled with 0, so the scan stops on them without allocating them.
  *
- * @param[in] memStepSize The amount of extra memory to allocate for the data array and loops stack when they run out of it, in bytes.
- * @param[in, out] inputData The input byte array to interpret.
- * @param[in] inputSize The size of the input
- * @param[in, out] inputIndex The index from which to interpret.
- * @param[in, out] data The data byte array.
+ * @param[in, out] vm The running virtual machine, whose data array is paged.
+ * @param[in] step The amount to move by.
  * @param[in, out] dataIndex The data index.
- * @param[in, out] dataSize The size of the data.
- * @param[in, out] loopStack The loop stack.
- * @param[in, out] loopStackIndex The index of the loop stack.
- * @param[in, out] loopStackSize The size of the loop stack.
+ *
+ * @return Whether or not the loop was run. If not, the original loop must be interpreted instead.
+ */
+bool scanPagedData(nib_vm* vm, int32_t step, size_t* dataIndex);
+/**
+ * Checks whether or not every value that a balanced loop moves to is on the current page of a paged data array,
+ * starting from its OP_RANGE operation.
+ *
+ * @param[in] vm The running virtual machine, whose data array is paged.
+ * @param[in] operation The OP_RANGE operation.
+ * @param[in] dataIndex The data index.
+ *
+ * @return Whether or not the copy of the loop can be run. If not, the original loop must be interpreted instead.
+ */
+bool checkPagedRange(const nib_vm* vm, const struct Operation* operation, size_t dataIndex);
+
+// The same loops, for data arrays whose values have 16 or 32 bits.
+bool multiplyData16(nib_vm* vm, const struct Operation* operation, size_t dataIndex);
+bool scanData16(nib_vm* vm, int32_t step, size_t* dataIndex);
+bool multiplyPagedData16(nib_vm* vm, const struct Operation* operation, size_t dataIndex);
+bool scanPagedData16(nib_vm* vm, int32_t step, size_t* dataIndex);
+bool multiplyData32(nib_vm* vm, const struct Operation* operation, size_t dataIndex);
+bool scanData32(nib_vm* vm, int32_t step, size_t* dataIndex);
+bool multiplyPagedData32(nib_vm* vm, const struct Operation* operation, size_t dataIndex);
+bool scanPagedData32(nib_vm* vm, int32_t step, size_t* dataIndex);
+
+/**
+ * Interprets the program of a virtual machine, until it ends or runs out of steps.
+ *
+ * @param[in, out] vm The running virtual machine.
  */
-void interpretSafely(uint32_t memStepSize, uint8_t** inputData, int32_t inputSize, uint32_t* inputIndex, uint8_t** data, uint32_t* dataIndex, uint32_t* dataSize, uint32_t** loopStack, uint32_t* loopStackIndex, uint32_t* loopStackSize);
+void interpret(nib_vm* vm);
 /**
- * Parses an instruction and interprets it.
+ * Interprets the program of a virtual machine safely, until it ends or runs out of steps.
  *
- * @param[in] instruction The instruction to parse.
- * @param[in] memStepSize The amount of extra memory to allocate for the data array and loops stack when they run out of it, in bytes.
- * @param[in, out] inputData The input byte array.
- * @param[in, out] inputIndex The index of the input.
- * @param[in, out] data The data byte array.
+ * @param[in, out] vm The running virtual machine.
+ */
+void interpretSafely(nib_vm* vm);
+/**
+ * Parses an operation and interprets it.
+ *
+ * @param[in] operation The operation to parse.
+ * @param[in, out] vm The running virtual machine.
+ * @param[in, out] programIndex The index of the operation. Loop operations set it to the index of the matching loop operation.
  * @param[in, out] dataIndex The data index.
- * @param[in, out] dataSize The size of the data.
- * @param[in, out] loopStack The loop stack.
- * @param[in, out] loopStackIndex The index of the loop stack.
- * @param[in, out] loopStackSize The size of the loop stack.
- * @param[out] skipLoop Whether or not to skip the current loop.
- * @param[out] inputIndexChanged Whether or not the input index was changed, and must not be moved again.
+ *
+ * @return Whether or not to continue. If not, the virtual machine ran out of steps at this operation.
  */
-void parseInstruction(uint8_t instruction, uint32_t memStepSize, uint8_t** inputData, uint32_t* inputIndex, uint8_t** data, uint32_t* dataIndex, uint32_t* dataSize, uint32_t** loopStack, uint32_t* loopStackIndex, uint32_t* loopStackSize, bool* skipLoop, bool* inputIndexChanged);
+bool parseInstruction(const struct Operation* operation, nib_vm* vm, uint32_t* programIndex, size_t* dataIndex);
 /**
- * Parses an instruction and interprets it safely.
+ * Parses an operation and interprets it safely.
  *
- * @param instruction The instruction to parse.
- * @param memStepSize The amount of extra memory to allocate for the data array and loops stack when they run out of it, in bytes.
- * @param inputIndex The index of the input.
- * @param data The data byte array.
+ * @param operation The operation to parse.
+ * @param vm The running virtual machine.
+ * @param programIndex The index of the operation. Loop operations set it to the index of the matching loop operation.
  * @param dataIndex The data index.
- * @param dataSize The size of the data.
- * @param loopStack The loop stack.
- * @param loopStackIndex The index of the loop stack.
- * @param loopStackSize The size of the loop stack.
- * @param skipLoop Whether or not to skip the current loop.
- * @param inputIndexChanged Whether or not the input index was changed, and must not be moved again.
- */
-void parseInstructionSafely(uint8_t instruction, uint32_t memStepSize, uint32_t* inputIndex, uint8_t** data, uint32_t* dataIndex, uint32_t* dataSize, uint32_t** loopStack, uint32_t* loopStackIndex, uint32_t* loopStackSize, bool* skipLoop, bool* inputIndexChanged);
+ *
+ * @return Whether or not to continue. If not, the virtual machine ran out of steps at this operation.
+ */
+bool parseInstructionSafely(const struct Operation* operation, nib_vm* vm, uint32_t* programIndex, size_t* dataIndex);
+
+/**
+ * Interprets the program of a virtual machine by using threaded dispatch, until it ends or runs out of steps.
+ *
+ * Unlike interpret(), the whole state is kept in locals and every operation is dispatched directly to the next one,
+ * without calling a function for each of them.
+ *
+ * @param[in, out] vm The running virtual machine.
+ */
+void interpretThreaded(nib_vm* vm);
+/**
+ * Interprets the program of a virtual machine safely by using threaded dispatch, until it ends or runs out of steps.
+ *
+ * @param[in, out] vm The running virtual machine.
+ */
+void interpretThreadedSafely(nib_vm* vm);
+
+/**
+ * Interprets the program of a virtual machine by using threaded dispatch, until it ends or runs out of steps, and
+ * counts every operation that it runs.
+ *
+ * @param[in, out] vm The running virtual machine, which has a profile.
+ */
+void interpretThreadedProfiled(nib_vm* vm);
+/**
+ * Interprets the program of a virtual machine safely by using threaded dispatch, until it ends or runs out of
+ * steps, and counts every operation that it runs.
+ *
+ * @param[in, out] vm The running virtual machine, which has a profile.
+ */
+void interpretThreadedSafelyProfiled(nib_vm* vm);
+/**
+ * Interprets the program of a virtual machine by using threaded dispatch on a paged data array, until it ends or
+ * runs out of steps.
+ *
+ * Moves only add to the data index, and every access makes sure that the data index is on the current page first.
+ *
+ * @param[in, out] vm The running virtual machine, whose data array is paged.
+ */
+void interpretThreadedPaged(nib_vm* vm);
+/**
+ * Interprets the program of a virtual machine safely by using threaded dispatch on a paged data array, until it
+ * ends or runs out of steps.
+ *
+ * @param[in, out] vm The running virtual machine, whose data array is paged.
+ */
+void interpretThreadedSafelyPaged(nib_vm* vm);
+/**
+ * Interprets the program of a virtual machine by using threaded dispatch on a paged data array, until it ends or
+ * runs out of steps, and counts every operation that it runs.
+ *
+ * @param[in, out] vm The running virtual machine, whose data array is paged and which has a profile.
+ */
+void interpretThreadedPagedProfiled(nib_vm* vm);
+/**
+ * Interprets the program of a virtual machine safely by using threaded dispatch on a paged data array, until it
+ * ends or runs out of steps, and counts every operation that it runs.
+ *
+ * @param[in, out] vm The running virtual machine, whose data array is paged and which has a profile.
+ */
+void interpretThreadedSafelyPagedProfiled(nib_vm* vm);
+/**
+ * Interprets the program of a virtual machine whose values have 16 or 32 bits, by using the variant of the threaded
+ * interpreter for its width and its options, until it ends or runs out of steps.
+ *
+ * @param[in, out] vm The running virtual machine.
+ */
+void interpretThreadedWide(nib_vm* vm);
+
+/**
+ * Compiles the program of a virtual machine to native code, unless it was already compiled, and runs it until it
+ * ends or runs out of steps.
+ *
+ * The JIT is only available on x86-64 POSIX systems. On other platforms, nothing is done and the caller must
+ * fall back to an interpreter.
+ *
+ * @param[in, out] vm The running virtual machine.
+ *
+ * @return Whether or not the program was run.
+ */
+bool interpretJit(nib_vm* vm);
+/**
+ * Frees the native code of a program.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void freeJit(nib_vm* vm);
+
+/**
+ * Allocates the profile of the program of a virtual machine, replacing the previous one.
+ *
+ * @param[in, out] vm The virtual machine.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+bool setupProfile(nib_vm* vm);
+/**
+ * Clears the profile of a virtual machine, if it has one.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void resetProfile(nib_vm* vm);
+/**
+ * Frees the profile of a virtual machine.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void freeProfile(nib_vm* vm);
+/**
+ * Gets the current time of a monotonic clock, which the profiler uses to measure the I/O and runs use for their
+ * time limit.
+ *
+ * @return The time, in seconds.
+ */
+double profileClock(void);
+
+/**
+ * Runs the program of a virtual machine at load time without any input, up to its first read or until its
+ * precomputed steps run out, and keeps where it stopped as its snapshot.
+ *
+ * Only operations whose effects are known are run, so the run stops before any read, before any move to a negative
+ * data index, and before the values or the output grow past what a snapshot can hold. Nothing is kept if the run
+ * stopped right away.
+ *
+ * @param[in, out] vm The virtual machine, whose program was just compiled or mapped.
+ */
+void precompute(nib_vm* vm);
+/**
+ * Gets the maximum amount of values that the snapshots of a virtual machine can use, which stays inside its memory
+ * limit.
+ *
+ * @param[in] vm The virtual machine.
+ *
+ * @return The amount of values.
+ */
+size_t snapshotLimit(const nib_vm* vm);
+/**
+ * Starts the program of a virtual machine from its snapshot, if it has one, right after its data array was reset.
+ * If the data array can't hold the snapshot, the program starts from its start instead.
+ *
+ * @param[in, out] vm The virtual machine.
+ *
+ * @return Whether or not the data array could be reset.
+ */
+bool restoreSnapshot(nib_vm* vm);
+/**
+ * Frees the snapshot of a virtual machine.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void freeSnapshot(nib_vm* vm);
+
+/**
+ * Unmaps the program of a virtual machine, if it was mapped from a cache file.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void freeCache(nib_vm* vm);
+
+/**
+ * Allocates the data array, filled with 0.
+ *
+ * With guard pages, the whole data array is reserved at once and invalid accesses to it are reported as errors. A
+ * paged data array only allocates its first page, and ignores the memory step size.
+ *
+ * @param[out] tape The data array.
+ * @param[in] options The options of the virtual machine, which give the memory step size, the memory limit, the
+ * width of the values and whether or not to split the data array into pages.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+bool setupTape(struct Tape* tape, const struct NibOptions* options);
+/**
+ * Grows the data array so that it contains the given data index.
+ *
+ * With guard pages, the data array never moves, and this is only needed when a new page is first used.
+ *
+ * @param[in, out] tape The data array.
+ * @param[in] dataIndex The data index that must fit inside the data array.
+ *
+ * @return Whether or not the memory could be allocated, and fits inside the memory limit.
+ */
+bool growTape(struct Tape* tape, size_t dataIndex);
+/**
+ * Gets the page of a paged data array that contains a data index.
+ *
+ * @param[in, out] tape The paged data array.
+ * @param[in] dataIndex The data index, which is below NIB_PAGED_LIMIT.
+ * @param[in] allocate Whether or not to allocate the page, and its page table, if it was never used.
+ *
+ * @return The page, or NULL if it was never used and is not allocated, or if its memory could not be allocated or
+ * is past the memory limit.
+ */
+uint8_t* getPage(struct Tape* tape, size_t dataIndex, bool allocate);
+/**
+ * Makes the page that contains a data index the current page of a paged data array, and allocates it if needed.
+ *
+ * @param[in, out] vm The running virtual machine, whose data array is paged.
+ * @param[in] dataIndex The data index.
+ * @param[in] inputIndex The input index of the operation that uses the data index, used when reporting errors.
+ */
+void enterPage(nib_vm* vm, size_t dataIndex, uint64_t inputIndex);
+/**
+ * Fills the data array with 0 again, and gives back the memory past its first step, or past its first page if the
+ * data array is paged.
+ *
+ * @param[in, out] tape The data array.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+bool resetTape(struct Tape* tape);
+/**
+ * Frees the data array.
+ *
+ * @param[in, out] tape The data array.
+ */
+void freeTape(struct Tape* tape);
+
+/**
+ * Allocates the output and input buffers of a virtual machine.
+ *
+ * @param[in, out] vm The virtual machine.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+bool setupBuffers(nib_vm* vm);
+/**
+ * Writes the buffered output of a virtual machine.
+ *
+ * @param[in, out] vm The virtual machine.
+ *
+ * @return Whether or not the output was written. The buffer is emptied either way.
+ */
+bool flushOutput(nib_vm* vm);
+/**
+ * Reads the next block of input into the input buffer, after flushing the output.
+ *
+ * @param[in, out] vm The running virtual machine.
+ *
+ * @return Whether or not any input was read. If not, the input has ended.
+ */
+bool fillInput(nib_vm* vm);
+/**
+ * Drops the buffered output and input of a virtual machine.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void resetBuffers(nib_vm* vm);
+/**
+ * Frees the output and input buffers of a virtual machine.
+ *
+ * @param[in, out] vm The virtual machine.
+ */
+void freeBuffers(nib_vm* vm);
+
+/**
+ * Writes a value to the output buffer, and flushes it if it's full.
+ *
+ * @param[in, out] vm The running virtual machine.
+ * @param[in] value The value to write.
+ */
+static inline void writeValue(nib_vm* vm, uint8_t value) {
+    *(vm->output.bytes + vm->output.size++) = value;
+    if((vm->output.size == vm->output.limit || (vm->options.lineBuffered && value == '\n')) && !flushOutput(vm))
+        raiseError(vm, NIB_ERROR_OUTPUT, 0);
+}
+/**
+ * Reads a value from the input buffer, and fills it if it's empty.
+ *
+ * @param[in, out] vm The running virtual machine.
+ *
+ * @return The value that was read, or EOF if the input has ended. Values of every width store EOF with all of their
+ * bits set.
+ */
+static inline int readValue(nib_vm* vm) {
+    if(vm->input.index == vm->input.size && !fillInput(vm))
+        return EOF;
+    return *(vm->input.bytes + vm->input.index++);
+}
 
 #endif
@@ -0,0 +1,617 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nib.h"
+
+#include <stdio.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#define NIB_SSE2
+#include <emmintrin.h>
+#endif
+
+// SSSE3 is not enabled by default, so its table lookups are only used if the CPU supports it.
+#if defined(NIB_SSE2) && (defined(__x86_64__) || defined(__i386__))
+#define NIB_SSSE3
+#include <immintrin.h>
+#endif
+
+#define MINIMIZE false
+#define STATISTICS false
+
+// The size of the first block that is read from the input, which is doubled until the whole input fits.
+#define READ_BLOCK_SIZE 65536u
+
+// Not an instruction, in the tables that convert BF characters to nibbles.
+#define NOT_INSTRUCTION 0xFFu
+// Set on the minimized instructions after which the current value is known to be 0.
+#define KNOWN_ZERO_BIT 0x80u
+
+/**
+ * Represents the format of a script.
+ */
+enum FORMAT {
+    FORMAT_BF,
+    FORMAT_NIB
+};
+
+// The BF character of every instruction nibble.
+static const char bfCharacters[8] = { '.', ']', '+', '>', '[', '-', '<', ',' };
+
+// The instruction nibble of every BF character, or NOT_INSTRUCTION.
+static uint8_t bfNibbles[256];
+
+#ifdef NIB_SSSE3
+// The shuffle that moves the bytes of every 8-bit mask to the start, in order.
+static uint8_t compactShuffles[256][8];
+#endif
+
+/**
+ * Writes an error to STDERR and terminates the program with the status code 1.
+ *
+ * @param[in] format The format of the error.
+ * @param[in] ... The additional arguments for the error format.
+ */
+static void error(const char* format, ...) {
+    va_list va;
+    va_start(va, format);
+
+    vfprintf(stderr, format, va);
+
+    va_end(va);
+    exit(1);
+}
+
+/**
+ * Initializes the tables that are used to convert BF characters to nibbles.
+ */
+static void initializeTables(void) {
+    for(uint32_t i = 0; i < 256; ++i)
+        bfNibbles[i] = NOT_INSTRUCTION;
+    for(uint8_t nibble = 0; nibble < 8; ++nibble)
+        bfNibbles[(uint8_t) bfCharacters[nibble]] = nibble;
+
+#ifdef NIB_SSSE3
+    // The bytes after the kept ones are either overwritten by the next half, or past the end of the nibbles.
+    for(uint32_t mask = 0; mask < 256; ++mask) {
+        uint32_t count = 0;
+        for(uint8_t i = 0; i < 8; ++i) {
+            if(mask & (1u << i))
+                compactShuffles[mask][count++] = i;
+        }
+    }
+#endif
+}
+
+/**
+ * Reads the whole contents of a file, which can also be a pipe.
+ *
+ * @param[in] input The file to read.
+ * @param[out] size The size of the contents, in bytes.
+ *
+ * @return The contents of the file, or NULL if they could not be read.
+ */
+static uint8_t* readAll(FILE* input, size_t* size) {
+    size_t capacity = READ_BLOCK_SIZE;
+
+    // Files are read at once when their size is known, and only pipes grow block by block.
+    if(fseek(input, 0, SEEK_END) == 0) {
+        const long fileSize = ftell(input);
+        if(fileSize > 0 && (unsigned long) fileSize < SIZE_MAX / 4)
+            capacity = (size_t) fileSize + 1;
+        rewind(input);
+    }
+
+    uint8_t* contents = (uint8_t*) malloc(capacity);
+    *size = 0;
+
+    while(contents != NULL) {
+        *size += fread(contents + *size, 1, capacity - *size, input);
+        if(ferror(input))
+            break;
+        if(*size < capacity)
+            return contents;
+
+        // The nibbles of a NIB script take twice its size, so the contents must stay below half of the address space.
+        uint8_t* grown = capacity <= SIZE_MAX / 4 ? (uint8_t*) realloc(contents, capacity * 2) : NULL;
+        if(grown == NULL)
+            break;
+        contents = grown;
+        capacity *= 2;
+    }
+
+    free(contents);
+    return NULL;
+}
+
+#ifdef NIB_SSSE3
+/**
+ * Converts BF characters to instruction nibbles by using SSSE3, 16 characters at a time.
+ *
+ * Every BF instruction is in the rows 0x2_, 0x3_ or 0x5_ of the ASCII table, so each row is looked up by the low half
+ * of the characters, and the row is picked by their high half.
+ *
+ * @param[in] source The characters.
+ * @param[in] sourceSize The amount of characters.
+ * @param[out] result The nibbles, which can be the same as the source.
+ * @param[out] resultSize The amount of nibbles.
+ *
+ * @return The amount of characters that were converted, which is a multiple of 16.
+ */
+__attribute__((target("ssse3")))
+static size_t scanBfSsse3(const uint8_t* source, const size_t sourceSize, uint8_t* result, size_t* resultSize) {
+    const __m128i mask = _mm_set1_epi8(RIGHT_MASK);
+    const __m128i none = _mm_set1_epi8((char) NOT_INSTRUCTION);
+    const __m128i row2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, NIB_INCREMENT_VALUE, NIB_READ_VALUE, NIB_DECREMENT_VALUE, NIB_WRITE_VALUE, -1);
+    const __m128i row3 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, NIB_DECREMENT_POINTER, -1, NIB_INCREMENT_POINTER, -1);
+    const __m128i row5 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, NIB_LOOP_START, -1, NIB_LOOP_END, -1, -1);
+    size_t count = 0;
+    size_t i = 0;
+
+    for(; i + 16 <= sourceSize; i += 16) {
+        const __m128i current = _mm_loadu_si128((const __m128i*) (source + i));
+        const __m128i low = _mm_and_si128(current, mask);
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(current, 4), mask);
+
+        const __m128i in2 = _mm_cmpeq_epi8(high, _mm_set1_epi8(2));
+        const __m128i in3 = _mm_cmpeq_epi8(high, _mm_set1_epi8(3));
+        const __m128i in5 = _mm_cmpeq_epi8(high, _mm_set1_epi8(5));
+
+        __m128i nibbles = _mm_and_si128(in2, _mm_shuffle_epi8(row2, low));
+        nibbles = _mm_or_si128(nibbles, _mm_and_si128(in3, _mm_shuffle_epi8(row3, low)));
+        nibbles = _mm_or_si128(nibbles, _mm_and_si128(in5, _mm_shuffle_epi8(row5, low)));
+        nibbles = _mm_or_si128(nibbles, _mm_andnot_si128(_mm_or_si128(_mm_or_si128(in2, in3), in5), none));
+
+        // Scripts are mostly instructions, so most blocks are stored whole. In the others, each half of the block
+        // is moved together by the shuffle of its instruction mask.
+        const uint32_t kept = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(nibbles, none)) ^ 0xFFFFu;
+        if(kept == 0xFFFFu) {
+            _mm_storeu_si128((__m128i*) (result + count), nibbles);
+            count += 16;
+            continue;
+        }
+
+        const __m128i lowHalf = _mm_shuffle_epi8(nibbles, _mm_loadl_epi64((const __m128i*) compactShuffles[kept & 0xFFu]));
+        const __m128i highHalf = _mm_shuffle_epi8(_mm_srli_si128(nibbles, 8), _mm_loadl_epi64((const __m128i*) compactShuffles[kept >> 8u]));
+        _mm_storel_epi64((__m128i*) (result + count), lowHalf);
+        count += (size_t) __builtin_popcount(kept & 0xFFu);
+        _mm_storel_epi64((__m128i*) (result + count), highHalf);
+        count += (size_t) __builtin_popcount(kept >> 8u);
+    }
+
+    *resultSize = count;
+    return i;
+}
+#endif
+
+/**
+ * Converts BF characters to instruction nibbles, one per byte, and leaves out the other characters.
+ *
+ * SSSE3 is used when available, in which case many characters are converted at once.
+ *
+ * @param[in] source The characters.
+ * @param[in] sourceSize The amount of characters.
+ * @param[out] result The nibbles, which can be the same as the source.
+ *
+ * @return The amount of nibbles.
+ */
+static size_t scanBf(const uint8_t* source, const size_t sourceSize, uint8_t* result) {
+    size_t count = 0;
+    size_t i = 0;
+
+#ifdef NIB_SSSE3
+    if(__builtin_cpu_supports("ssse3"))
+        i = scanBfSsse3(source, sourceSize, result, &count);
+#endif
+
+    for(; i < sourceSize; ++i) {
+        const uint8_t nibble = bfNibbles[*(source + i)];
+        *(result + count) = nibble;
+        count += nibble != NOT_INSTRUCTION;
+    }
+    return count;
+}
+
+/**
+ * Leaves out the padding nibbles of decoded nibbles.
+ *
+ * SSE2 is used when available, in which case blocks without padding are kept 16 nibbles at a time.
+ *
+ * @param[in, out] nibbles The nibbles.
+ * @param[in] size The amount of nibbles.
+ *
+ * @return The amount of nibbles that were kept.
+ */
+static size_t dropPadding(uint8_t* nibbles, const size_t size) {
+    size_t count = 0;
+    size_t i = 0;
+
+#ifdef NIB_SSE2
+    for(; i + 16 <= size; i += 16) {
+        const __m128i current = _mm_loadu_si128((const __m128i*) (nibbles + i));
+
+        // Move the padding bit of every nibble to the top of its byte, where the byte mask is taken from.
+        if(_mm_movemask_epi8(_mm_slli_epi16(current, 4)) == 0) {
+            _mm_storeu_si128((__m128i*) (nibbles + count), current);
+            count += 16;
+            continue;
+        }
+
+        for(uint32_t j = 0; j < 16; ++j) {
+            const uint8_t nibble = *(nibbles + i + j);
+            *(nibbles + count) = nibble;
+            count += !(nibble & NIB_PADDING_BIT);
+        }
+    }
+#endif
+
+    for(; i < size; ++i) {
+        const uint8_t nibble = *(nibbles + i);
+        *(nibbles + count) = nibble;
+        count += !(nibble & NIB_PADDING_BIT);
+    }
+    return count;
+}
+
+#ifdef NIB_SSSE3
+/**
+ * Converts instruction nibbles to BF characters by using SSSE3, 16 nibbles at a time.
+ *
+ * @param[in] nibbles The nibbles.
+ * @param[in] size The amount of nibbles.
+ * @param[out] result The characters, which can be the same as the nibbles.
+ *
+ * @return The amount of nibbles that were converted, which is a multiple of 16.
+ */
+__attribute__((target("ssse3")))
+static size_t unpackBfSsse3(const uint8_t* nibbles, const size_t size, uint8_t* result) {
+    const __m128i mask = _mm_set1_epi8(0b0111);
+    const __m128i table = _mm_setr_epi8('.', ']', '+', '>', '[', '-', '<', ',', 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t i = 0;
+
+    for(; i + 16 <= size; i += 16) {
+        const __m128i current = _mm_and_si128(_mm_loadu_si128((const __m128i*) (nibbles + i)), mask);
+        _mm_storeu_si128((__m128i*) (result + i), _mm_shuffle_epi8(table, current));
+    }
+    return i;
+}
+#endif
+
+/**
+ * Converts instruction nibbles to BF characters.
+ *
+ * SSSE3 is used when available, in which case many nibbles are converted at once.
+ *
+ * @param[in] nibbles The nibbles, which can have the known zero bit set.
+ * @param[in] size The amount of nibbles.
+ * @param[out] result The characters, which can be the same as the nibbles.
+ */
+static void unpackBf(const uint8_t* nibbles, const size_t size, uint8_t* result) {
+    size_t i = 0;
+
+#ifdef NIB_SSSE3
+    if(__builtin_cpu_supports("ssse3"))
+        i = unpackBfSsse3(nibbles, size, result);
+#endif
+
+    for(; i < size; ++i)
+        *(result + i) = (uint8_t) bfCharacters[*(nibbles + i) & 0b0111u];
+}
+
+/**
+ * Packs instruction nibbles two per byte, and pads the last byte with the standard padding nibble if needed.
+ *
+ * SSE2 is used when available, in which case 32 nibbles are packed at once.
+ *
+ * @param[in] nibbles The nibbles, which can have the known zero bit set.
+ * @param[in] size The amount of nibbles.
+ * @param[out] result The packed nibbles, which can be the same as the nibbles.
+ *
+ * @return The size of the packed nibbles, in bytes.
+ */
+static size_t pack(const uint8_t* nibbles, const size_t size, uint8_t* result) {
+    size_t i = 0;
+
+#ifdef NIB_SSE2
+    const __m128i leftMask = _mm_set1_epi16(LEFT_MASK);
+    const __m128i rightMask = _mm_set1_epi16(RIGHT_MASK);
+
+    for(; i + 32 <= size; i += 32) {
+        const __m128i first = _mm_loadu_si128((const __m128i*) (nibbles + i));
+        const __m128i second = _mm_loadu_si128((const __m128i*) (nibbles + i + 16));
+
+        // Every 16-bit lane holds a left nibble in its low byte and a right nibble in its high byte, which are
+        // moved into the low byte and then narrowed to bytes.
+        const __m128i firstBytes = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(first, 4), leftMask), _mm_and_si128(_mm_srli_epi16(first, 8), rightMask));
+        const __m128i secondBytes = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(second, 4), leftMask), _mm_and_si128(_mm_srli_epi16(second, 8), rightMask));
+        _mm_storeu_si128((__m128i*) (result + i / 2), _mm_packus_epi16(firstBytes, secondBytes));
+    }
+#endif
+
+    for(; i + 2 <= size; i += 2)
+        *(result + i / 2) = (uint8_t) (((*(nibbles + i) << 4u) & LEFT_MASK) | (*(nibbles + i + 1) & RIGHT_MASK));
+
+    // The standard padding nibble.
+    if(i < size)
+        *(result + i / 2) = (uint8_t) (((*(nibbles + i) << 4u) & LEFT_MASK) | NIB_PADDING_BIT);
+
+    return (size + 1) / 2;
+}
+
+/**
+ * Checks that every loop of some instruction nibbles has an end, and that every loop end has a start.
+ *
+ * @param[in] nibbles The nibbles.
+ * @param[in] size The amount of nibbles.
+ * @param[out] errorIndex The index of the first unmatched loop start or end, if any.
+ *
+ * @return Whether or not the loops are balanced.
+ */
+static bool balanced(const uint8_t* nibbles, const size_t size, size_t* errorIndex) {
+    size_t depth = 0;
+    size_t start = 0;
+
+    for(size_t i = 0; i < size; ++i) {
+        if(*(nibbles + i) == NIB_LOOP_START) {
+            if(depth++ == 0)
+                start = i;
+        } else if(*(nibbles + i) == NIB_LOOP_END) {
+            if(depth == 0) {
+                *errorIndex = i;
+                return false;
+            }
+            --depth;
+        }
+    }
+
+    *errorIndex = start;
+    return depth == 0;
+}
+
+/**
+ * Gets the instruction that undoes another one.
+ *
+ * @param[in] instruction The instruction.
+ *
+ * @return The instruction that undoes it, or NOT_INSTRUCTION if there is none.
+ */
+static uint8_t inverse(const uint8_t instruction) {
+    switch(instruction) {
+        case NIB_INCREMENT_POINTER: return NIB_DECREMENT_POINTER;
+        case NIB_DECREMENT_POINTER: return NIB_INCREMENT_POINTER;
+        case NIB_INCREMENT_VALUE: return NIB_DECREMENT_VALUE;
+        case NIB_DECREMENT_VALUE: return NIB_INCREMENT_VALUE;
+        default: return NOT_INSTRUCTION;
+    }
+}
+
+/**
+ * Minimizes balanced instruction nibbles in place.
+ *
+ * Instructions that undo the previous kept instruction (e.g. + after -) are removed together with it, and loops that
+ * start while the current value is known to be 0 are never entered, so they are removed whole. The value is known to
+ * be 0 at the start of the script, after a loop, and after moves while no value was changed yet. Every kept
+ * instruction has the known zero bit set if the value is known to be 0 after it, so that it can be known again
+ * once the instructions after it are removed.
+ *
+ * @param[in, out] nibbles The nibbles.
+ * @param[in] size The amount of nibbles.
+ *
+ * @return The amount of nibbles that were kept.
+ */
+static size_t minimize(uint8_t* nibbles, const size_t size) {
+    size_t count = 0;
+    // The amount of kept instructions that change values. While there are none, every value is 0.
+    size_t changes = 0;
+    bool zero = true;
+
+    for(size_t i = 0; i < size; ++i) {
+        const uint8_t instruction = *(nibbles + i);
+
+        if(instruction == NIB_LOOP_START && zero) {
+            for(size_t depth = 1; depth != 0;) {
+                const uint8_t current = *(nibbles + (++i));
+                if(current == NIB_LOOP_START)
+                    ++depth;
+                else if(current == NIB_LOOP_END)
+                    --depth;
+            }
+            continue;
+        }
+
+        if(count != 0 && (*(nibbles + count - 1) & RIGHT_MASK) == inverse(instruction)) {
+            --count;
+            if(instruction == NIB_INCREMENT_VALUE || instruction == NIB_DECREMENT_VALUE)
+                --changes;
+            zero = count == 0 || (*(nibbles + count - 1) & KNOWN_ZERO_BIT);
+            continue;
+        }
+
+        switch(instruction) {
+            case NIB_INCREMENT_VALUE:
+            case NIB_DECREMENT_VALUE:
+            case NIB_READ_VALUE:
+                ++changes;
+                zero = false;
+                break;
+            case NIB_INCREMENT_POINTER:
+            case NIB_DECREMENT_POINTER:
+                zero = changes == 0;
+                break;
+            case NIB_LOOP_END:
+                zero = true;
+                break;
+            default:
+                break;
+        }
+
+        *(nibbles + (count++)) = (uint8_t) (instruction | (zero ? KNOWN_ZERO_BIT : 0));
+    }
+    return count;
+}
+
+/**
+ * Writes the whole contents of a file.
+ *
+ * @param[in] path The path of the file, or NULL to write to STDOUT.
+ * @param[in] contents The contents.
+ * @param[in] size The size of the contents, in bytes.
+ *
+ * @return Whether or not the contents were written.
+ */
+static bool writeAll(const char* path, const uint8_t* contents, const size_t size) {
+    FILE* output = path != NULL ? fopen(path, "wb") : stdout;
+    if(output == NULL)
+        return false;
+
+    bool written = fwrite(contents, 1, size, output) == size;
+    written = (path != NULL ? fclose(output) : fflush(output)) == 0 && written;
+    return written;
+}
+
+/**
+ * Parses the name of a script format.
+ *
+ * @param[in] name The name, either bf or nib.
+ * @param[out] format The format.
+ *
+ * @return Whether or not the name is valid.
+ */
+static bool parseFormat(const char* name, enum FORMAT* format) {
+    if(strcmp("bf", name) == 0)
+        *format = FORMAT_BF;
+    else if(strcmp("nib", name) == 0)
+        *format = FORMAT_NIB;
+    else return false;
+    return true;
+}
+
+/**
+ * The main function.
+ *
+ * Converts a script from one format to another, which is BF to NIB by default. The script is read from a file, or
+ * from STDIN if the file is "-", and is written to STDOUT unless an output file is given.
+ *
+ * @param argc The number of command-line arguments.
+ * @param argv The command-line arguments.
+ *
+ * @return The program exit code.
+ */
+int main(int argc, char** argv) {
+    if(argc < 2)
+        error("Invalid arguments");
+
+    const char* script = *(++argv);
+    const char* outputPath = NULL;
+    enum FORMAT from = FORMAT_BF;
+    enum FORMAT to = FORMAT_NIB;
+    bool minimizing = MINIMIZE;
+    bool statistics = STATISTICS;
+
+    for(++argv, argc -= 2; argc > 0; --argc, ++argv) {
+        if(strcmp("--from", *argv) == 0 || strcmp("--to", *argv) == 0) {
+            if(argc == 1)
+                error("Expected format");
+            if(!parseFormat(*(argv + 1), strcmp("--from", *argv) == 0 ? &from : &to))
+                error("Invalid format '%s'", *(argv + 1));
+            ++argv;
+            --argc;
+        } else if(strcmp("-o", *argv) == 0 || strcmp("--output", *argv) == 0) {
+            if(argc == 1)
+                error("Expected output file");
+            outputPath = *(++argv);
+            --argc;
+        } else if(strcmp("-m", *argv) == 0 || strcmp("--minimize", *argv) == 0) {
+            minimizing = true;
+        } else if(strcmp("--stats", *argv) == 0) {
+            statistics = true;
+        } else error("Invalid argument '%s'", *argv);
+    }
+
+    FILE* input = strcmp("-", script) == 0 ? stdin : fopen(script, "rb");
+    if(input == NULL)
+        error("Invalid input file, or insufficient permissions");
+
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    size_t sourceSize = 0;
+    uint8_t* source = readAll(input, &sourceSize);
+    if(input != stdin)
+        fclose(input);
+    if(source == NULL)
+        error("Could not read input file");
+
+    // Convert the script to one instruction nibble per byte. BF scripts are converted in place, while the nibbles of
+    // NIB scripts take twice their size.
+    uint8_t* nibbles = source;
+    size_t nibbleCount;
+
+    if(from == FORMAT_NIB) {
+        nibbles = (uint8_t*) malloc(sourceSize > 0 ? sourceSize * 2 : 1);
+        if(nibbles == NULL)
+            error("Could not allocate memory for the script");
+
+        decodeInto(source, sourceSize, nibbles);
+        nibbleCount = dropPadding(nibbles, sourceSize * 2);
+        free(source);
+    } else {
+        initializeTables();
+
+        nibbleCount = scanBf(source, sourceSize, nibbles);
+    }
+
+    const size_t instructionCount = nibbleCount;
+    if(minimizing) {
+        // Unbalanced scripts are rejected when they're run, so they're left as they are instead of being changed.
+        size_t errorIndex = 0;
+        if(!balanced(nibbles, nibbleCount, &errorIndex)) {
+            error(*(nibbles + errorIndex) == NIB_LOOP_END ? "Unexpected end of loop at instruction index '%llu'" : "Expected end of loop for the loop at instruction index '%llu'",
+                  (unsigned long long) errorIndex);
+        }
+        nibbleCount = minimize(nibbles, nibbleCount);
+    }
+
+    size_t resultSize = nibbleCount;
+    if(to == FORMAT_NIB)
+        resultSize = pack(nibbles, nibbleCount, nibbles);
+    else unpackBf(nibbles, nibbleCount, nibbles);
+
+    if(!writeAll(outputPath, nibbles, resultSize))
+        error("Could not write output file");
+
+    if(statistics) {
+        fprintf(stderr, "Read %llu instructions from %llu bytes, and wrote %llu instructions to %llu bytes\n",
+                (unsigned long long) instructionCount, (unsigned long long) sourceSize,
+                (unsigned long long) nibbleCount, (unsigned long long) resultSize);
+    }
+
+    free(nibbles);
+    return 0;
+}
@@ -0,0 +1,398 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nib.h"
+
+// The amount of values and output bytes that are allocated at first, which doubles whenever it runs out.
+#define EVALUATION_STEP 4096u
+
+/**
+ * Represents a program that is being precomputed. Every value is kept as 32 bits, and only wraps around at the width
+ * of the values of the virtual machine.
+ */
+struct Evaluation {
+    uint32_t* values;
+    // The amount of values that were allocated, which are all 0 past the ones that were used.
+    size_t valueLimit;
+    // The amount of values that were used.
+    size_t usedValues;
+    // The maximum amount of values that can be used.
+    size_t maxValues;
+    // The bits that the values keep.
+    uint32_t mask;
+
+    uint8_t* output;
+    size_t outputSize;
+    size_t outputLimit;
+
+    // The amount of steps that can still be taken.
+    uint64_t steps;
+    // Whether or not memory could not be allocated, in which case nothing is kept.
+    bool failed;
+    // The loop start and the loop end of the last copy of a balanced loop that was entered, and the loop end of its
+    // original loop.
+    uint32_t copyStart;
+    uint32_t copyEnd;
+    uint32_t originalEnd;
+};
+
+/**
+ * Makes sure that the data array of a program that is being precomputed holds a data index.
+ *
+ * @param[in, out] evaluation The program that is being precomputed.
+ * @param[in] dataIndex The data index, which wrapped around if it's negative.
+ *
+ * @return Whether or not the data index can be used. If not, the program must stop before using it.
+ */
+static bool useValue(struct Evaluation* evaluation, const size_t dataIndex) {
+    if(dataIndex >= evaluation->maxValues)
+        return false;
+
+    if(dataIndex >= evaluation->valueLimit) {
+        size_t limit = evaluation->valueLimit != 0 ? evaluation->valueLimit : EVALUATION_STEP;
+        while(limit <= dataIndex)
+            limit *= 2;
+        if(limit > evaluation->maxValues)
+            limit = evaluation->maxValues;
+
+        uint32_t* values = (uint32_t*) realloc(evaluation->values, limit * sizeof(uint32_t));
+        if(values == NULL) {
+            evaluation->failed = true;
+            return false;
+        }
+
+        memset(values + evaluation->valueLimit, 0, (limit - evaluation->valueLimit) * sizeof(uint32_t));
+        evaluation->values = values;
+        evaluation->valueLimit = limit;
+    }
+
+    if(dataIndex >= evaluation->usedValues)
+        evaluation->usedValues = dataIndex + 1;
+    return true;
+}
+
+/**
+ * Adds a byte to the output of a program that is being precomputed.
+ *
+ * @param[in, out] evaluation The program that is being precomputed.
+ * @param[in] value The byte to write.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+static bool writeOutput(struct Evaluation* evaluation, const uint8_t value) {
+    if(evaluation->outputSize == evaluation->outputLimit) {
+        const size_t limit = evaluation->outputLimit != 0 ? evaluation->outputLimit * 2 : EVALUATION_STEP;
+        uint8_t* output = (uint8_t*) realloc(evaluation->output, limit);
+        if(output == NULL) {
+            evaluation->failed = true;
+            return false;
+        }
+
+        evaluation->output = output;
+        evaluation->outputLimit = limit;
+    }
+
+    *(evaluation->output + evaluation->outputSize++) = value;
+    return true;
+}
+
+/**
+ * Runs an operation of a program that is being precomputed, like parseInstruction().
+ *
+ * @param[in] program The program.
+ * @param[in, out] evaluation The program that is being precomputed.
+ * @param[in, out] programIndex The index of the operation. Loop operations set it to the index of the matching loop operation.
+ * @param[in, out] dataIndex The data index.
+ *
+ * @return Whether or not to continue. If not, the operation was not run, and the program stops right before it.
+ */
+static bool evaluate(const struct Operation* program, struct Evaluation* evaluation, uint32_t* programIndex, size_t* dataIndex) {
+    const struct Operation* operation = program + *programIndex;
+    uint32_t* values = evaluation->values;
+
+    switch(operation->type) {
+        case OP_MOVE: {
+            // Moving to a negative index fails or is ignored, which is left to the run.
+            if(operation->count < 0 && *dataIndex < (size_t) -(int64_t) operation->count)
+                return false;
+            if(!useValue(evaluation, *dataIndex + operation->count))
+                return false;
+
+            *dataIndex += operation->count;
+            break;
+        }
+        case OP_ADD: {
+            uint32_t* value = values + *dataIndex + operation->offset;
+            *value = (*value + (uint32_t) operation->count) & evaluation->mask;
+            break;
+        }
+        case OP_WRITE: {
+            // Runs can't start inside the copy of a balanced loop, so it only stops at its loop end once the output is
+            // full, after writing less than one more repetition.
+            const bool copied = *programIndex > evaluation->copyStart && *programIndex < evaluation->copyEnd;
+            if(evaluation->outputSize >= NIB_SNAPSHOT_LIMIT && !copied)
+                return false;
+            return writeOutput(evaluation, (uint8_t) *(values + *dataIndex + operation->offset));
+        }
+        case OP_READ: {
+            // Everything from here on may depend on the input.
+            return false;
+        }
+        case OP_LOOP_START: {
+            if(*(values + *dataIndex) == 0)
+                *programIndex = operation->jump;
+            break;
+        }
+        case OP_LOOP_END: {
+            if(*(values + *dataIndex) != 0) {
+                if(evaluation->steps < (uint32_t) operation->count || evaluation->outputSize >= NIB_SNAPSHOT_LIMIT)
+                    return false;
+
+                evaluation->steps -= (uint32_t) operation->count;
+                *programIndex = operation->jump;
+            }
+            break;
+        }
+        case OP_CLEAR: {
+            *(values + *dataIndex + operation->offset) = 0;
+            break;
+        }
+        case OP_MULTIPLY: {
+            const uint32_t value = *(values + *dataIndex);
+            if(value != 0) {
+                // The loop would move to a negative index, or past the values that can be used.
+                const struct Operation* last = operation + operation->count;
+                if(operation->offset < 0 && *dataIndex < (size_t) -(int64_t) operation->offset)
+                    return false;
+                if(operation->count > 0 && last->offset > 0 && !useValue(evaluation, *dataIndex + last->offset))
+                    return false;
+
+                values = evaluation->values;
+                for(const struct Operation* multiply = operation + 1; multiply <= last; ++multiply) {
+                    uint32_t* target = values + *dataIndex + multiply->offset;
+                    *target = (*target + value * (uint32_t) multiply->count) & evaluation->mask;
+                }
+                *(values + *dataIndex) = 0;
+            }
+
+            *programIndex = operation->jump;
+            break;
+        }
+        case OP_SCAN: {
+            // The values past the ones that were allocated are all 0.
+            size_t index = *dataIndex;
+            while(index < evaluation->valueLimit && *(values + index) != 0) {
+                if(operation->count < 0 && index < (size_t) -(int64_t) operation->count)
+                    return false;
+                index += operation->count;
+            }
+            if(!useValue(evaluation, index))
+                return false;
+
+            *dataIndex = index;
+            *programIndex = operation->jump;
+            break;
+        }
+        case OP_RANGE: {
+            if(operation->offset < 0 && *dataIndex < (size_t) -(int64_t) operation->offset)
+                return false;
+            if(!useValue(evaluation, *dataIndex + operation->count))
+                return false;
+
+            // Runs can't start inside the copy, so reading from it is left to the run.
+            const uint32_t copyStart = operation->jump + 1;
+            const uint32_t copyEnd = (program + copyStart)->jump;
+            for(uint32_t i = copyStart + 1; i < copyEnd; ++i) {
+                if((program + i)->type == OP_READ)
+                    return false;
+            }
+
+            evaluation->copyStart = copyStart;
+            evaluation->copyEnd = copyEnd;
+            evaluation->originalEnd = operation->jump;
+            *programIndex = operation->jump;
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+    return true;
+}
+
+/**
+ * Keeps where a program that was precomputed stopped as the snapshot of a virtual machine.
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in] evaluation The program that was precomputed.
+ * @param[in] programIndex The index of the operation to resume from.
+ * @param[in] dataIndex The data index.
+ */
+static void keepSnapshot(nib_vm* vm, const struct Evaluation* evaluation, const uint32_t programIndex, const size_t dataIndex) {
+    const uint32_t cellSize = vm->tape.cellSize;
+
+    size_t cellCount = evaluation->usedValues;
+    while(cellCount > 0 && *(evaluation->values + cellCount - 1) == 0)
+        --cellCount;
+
+    struct Snapshot* snapshot = (struct Snapshot*) malloc(sizeof(struct Snapshot));
+    uint8_t* memory = (uint8_t*) malloc(cellCount * cellSize + evaluation->outputSize + 1);
+    if(snapshot == NULL || memory == NULL) {
+        free(snapshot);
+        free(memory);
+        return;
+    }
+
+    // Store the values at the width of the data array, so that they are only copied when restored.
+    for(size_t i = 0; i < cellCount; ++i) {
+        const uint32_t value = *(evaluation->values + i);
+
+        if(cellSize == 1)
+            *(memory + i) = (uint8_t) value;
+        else if(cellSize == 2)
+            memcpy(memory + i * 2, &(uint16_t) { (uint16_t) value }, 2);
+        else memcpy(memory + i * 4, &value, 4);
+    }
+    if(evaluation->outputSize != 0)
+        memcpy(memory + cellCount * cellSize, evaluation->output, evaluation->outputSize);
+
+    snapshot->programIndex = programIndex;
+    snapshot->dataIndex = dataIndex;
+    snapshot->steps = vm->options.precomputeSteps - evaluation->steps;
+    snapshot->usedValues = evaluation->usedValues;
+    snapshot->cells = memory;
+    snapshot->cellCount = cellCount;
+    snapshot->output = memory + cellCount * cellSize;
+    snapshot->outputSize = evaluation->outputSize;
+    snapshot->memory = memory;
+
+    vm->snapshot = snapshot;
+}
+
+void precompute(nib_vm* vm) {
+    freeSnapshot(vm);
+
+    struct Evaluation evaluation;
+    memset(&evaluation, 0, sizeof(evaluation));
+    evaluation.maxValues = snapshotLimit(vm);
+    evaluation.mask = vm->options.cellBits == 32 ? UINT32_MAX : ((uint32_t) 1 << vm->options.cellBits) - 1;
+    evaluation.steps = vm->options.precomputeSteps;
+
+    uint32_t programIndex = 0;
+    size_t dataIndex = 0;
+
+    if(useValue(&evaluation, 0)) {
+        // Run the operation, and move past it or past the loop operation that was jumped to.
+        while(programIndex < vm->programSize && evaluate(vm->program, &evaluation, &programIndex, &dataIndex))
+            ++programIndex;
+
+        // The copy of a balanced loop uses values that were only checked before it, so its original loop resumes
+        // instead, which works the same from its loop end.
+        if(programIndex == evaluation.copyEnd && programIndex != 0)
+            programIndex = evaluation.originalEnd;
+
+        if(programIndex != 0 && !evaluation.failed)
+            keepSnapshot(vm, &evaluation, programIndex, dataIndex);
+    }
+
+    free(evaluation.values);
+    free(evaluation.output);
+}
+
+size_t snapshotLimit(const nib_vm* vm) {
+    size_t limit = vm->tape.memoryLimit;
+
+    // The paged data array only allocates whole pages, and always has its first one.
+    if(vm->tape.pages != NULL)
+        limit = limit >= NIB_PAGE_SIZE ? limit / NIB_PAGE_SIZE * NIB_PAGE_SIZE : NIB_PAGE_SIZE;
+    return limit < NIB_SNAPSHOT_LIMIT ? limit : NIB_SNAPSHOT_LIMIT;
+}
+
+/**
+ * Checks whether or not every byte of an array is 0.
+ *
+ * @param[in] bytes The array.
+ * @param[in] size The size of the array, in bytes.
+ *
+ * @return Whether or not every byte is 0.
+ */
+static bool allZero(const uint8_t* bytes, const size_t size) {
+    for(size_t i = 0; i < size; ++i) {
+        if(*(bytes + i) != 0)
+            return false;
+    }
+    return true;
+}
+
+bool restoreSnapshot(nib_vm* vm) {
+    const struct Snapshot* snapshot = vm->snapshot;
+    if(snapshot == NULL)
+        return true;
+
+    struct Tape* tape = &vm->tape;
+    const uint32_t cellSize = tape->cellSize;
+
+    if(tape->pages != NULL) {
+        // Only the pages that hold values other than 0 are allocated, which the run would have allocated anyway.
+        for(size_t start = 0; start < snapshot->cellCount; start += NIB_PAGE_SIZE) {
+            const size_t count = snapshot->cellCount - start < NIB_PAGE_SIZE ? snapshot->cellCount - start : NIB_PAGE_SIZE;
+            const uint8_t* cells = snapshot->cells + start * cellSize;
+            if(allZero(cells, count * cellSize))
+                continue;
+
+            uint8_t* page = getPage(tape, start, true);
+            if(page == NULL)
+                return resetTape(tape);
+            memcpy(page, cells, count * cellSize);
+        }
+    } else {
+        // The unsafe interpreters only grow the data array when moving, so it must be as large as after the steps.
+        if(snapshot->usedValues > tape->size && !growTape(tape, snapshot->usedValues - 1))
+            return resetTape(tape);
+        memcpy(tape->cells, snapshot->cells, snapshot->cellCount * cellSize);
+    }
+
+    vm->programIndex = snapshot->programIndex;
+    vm->dataIndex = snapshot->dataIndex;
+    vm->snapshotPending = true;
+    return true;
+}
+
+void freeSnapshot(nib_vm* vm) {
+    if(vm->snapshot == NULL)
+        return;
+
+    free(vm->snapshot->memory);
+    free(vm->snapshot);
+    vm->snapshot = NULL;
+    vm->snapshotPending = false;
+}
+
+bool nibGetSnapshot(const nib_vm* vm, struct NibSnapshot* snapshot) {
+    if(vm->snapshot == NULL)
+        return false;
+
+    snapshot->steps = vm->snapshot->steps;
+    snapshot->outputSize = vm->snapshot->outputSize;
+    snapshot->inputIndex = (vm->program + vm->snapshot->programIndex)->inputIndex;
+    return true;
+}
@@ -0,0 +1,150 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Needed for clock_gettime() when compiling in strict C11 mode.
+#define _DEFAULT_SOURCE
+
+#include "nib.h"
+
+#include <time.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NIB_PROFILE_POSIX
+#elif defined(_WIN32)
+#define NIB_PROFILE_WINDOWS
+#include <windows.h>
+#endif
+
+bool setupProfile(nib_vm* vm) {
+    freeProfile(vm);
+
+    vm->profile = (struct Profile*) calloc(1, sizeof(struct Profile));
+    if(vm->profile == NULL)
+        return false;
+
+    // The OP_END operation is counted too, so that the interpreter doesn't need to check for it.
+    vm->profile->executions = (uint64_t*) calloc((size_t) vm->programSize + 1, sizeof(uint64_t));
+    if(vm->profile->executions == NULL) {
+        freeProfile(vm);
+        return false;
+    }
+    return true;
+}
+
+void resetProfile(nib_vm* vm) {
+    struct Profile* profile = vm->profile;
+    if(profile == NULL)
+        return;
+
+    memset(profile->executions, 0, ((size_t) vm->programSize + 1) * sizeof(uint64_t));
+    profile->steps = 0;
+    profile->maxDataIndex = 0;
+    profile->ioSeconds = 0;
+}
+
+void freeProfile(nib_vm* vm) {
+    if(vm->profile == NULL)
+        return;
+
+    free(vm->profile->executions);
+    free(vm->profile);
+    vm->profile = NULL;
+}
+
+double profileClock(void) {
+#if defined(NIB_PROFILE_POSIX)
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+#elif defined(NIB_PROFILE_WINDOWS)
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+#else
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+#endif
+}
+
+bool nibGetProfile(const nib_vm* vm, struct NibProfile* profile) {
+    if(vm->profile == NULL)
+        return false;
+
+    profile->operations = 0;
+    for(uint32_t i = 0; i < vm->programSize; ++i)
+        profile->operations += *(vm->profile->executions + i);
+
+    profile->steps = vm->profile->steps;
+    profile->maxDataIndex = vm->profile->maxDataIndex;
+    profile->ioSeconds = vm->profile->ioSeconds;
+
+    return true;
+}
+
+uint32_t nibGetHotLoops(const nib_vm* vm, struct NibLoopProfile* loops, const uint32_t count) {
+    if(vm->profile == NULL || count == 0)
+        return 0;
+
+    // The amount of operations that were run before every operation, so that the amount inside a loop is the
+    // difference between the ones around it.
+    uint64_t* totals = (uint64_t*) malloc(((size_t) vm->programSize + 1) * sizeof(uint64_t));
+    if(totals == NULL)
+        return 0;
+
+    *totals = 0;
+    for(uint32_t i = 0; i < vm->programSize; ++i)
+        *(totals + i + 1) = *(totals + i) + *(vm->profile->executions + i);
+
+    uint32_t loopCount = 0;
+
+    for(uint32_t end = 0; end < vm->programSize; ++end) {
+        const struct Operation* operation = vm->program + end;
+
+        // Every run of the body of a loop ends at its loop end.
+        const uint64_t iterations = *(vm->profile->executions + end);
+        if(operation->type != OP_LOOP_END || iterations == 0)
+            continue;
+
+        const uint32_t start = operation->jump;
+        struct NibLoopProfile loop;
+        loop.inputIndex = (vm->program + start)->inputIndex;
+        loop.iterations = iterations;
+        loop.operations = *(totals + end + 1) - *(totals + start);
+
+        // Keep the hottest loops sorted.
+        uint32_t position = loopCount < count ? loopCount++ : count;
+
+        while(position > 0 && (loops + position - 1)->operations < loop.operations) {
+            if(position < count)
+                *(loops + position) = *(loops + position - 1);
+            --position;
+        }
+        if(position < count)
+            *(loops + position) = loop;
+    }
+
+    free(totals);
+    return loopCount;
+}
@@ -0,0 +1,192 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nib.h"
+
+/**
+ * Represents the part of a streamed script that was read but not run yet.
+ */
+struct Stream {
+    // The decoded nibbles, from the oldest loop that is still open, or from where the last run stopped.
+    uint8_t* nibbles;
+    size_t size;
+    size_t limit;
+    // The input index of the first nibble.
+    uint64_t inputIndex;
+    // The amount of nibbles whose loops were counted, and the amount of loops that are still open after them.
+    size_t counted;
+    size_t depth;
+    // The amount of nibbles before the oldest loop that is still open, which can be compiled on their own.
+    size_t closed;
+    // Stands in for the last OP_MOVE that was run and the operation after it, once the program that they were
+    // part of is replaced, as guard pages report the operation after the last move.
+    struct Operation lastMove[2];
+};
+
+/**
+ * Reads the next chunk of a streamed script, and decodes it after the nibbles that were not run yet.
+ *
+ * @param[in, out] stream The stream.
+ * @param[out] chunk The buffer to read the chunk into.
+ * @param[in] chunkLimit The size of the chunk buffer, in bytes.
+ * @param[in] read The function that reads the script.
+ * @param[in] context The context that is passed to the read function.
+ * @param[out] ended Whether or not the script has ended.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+static bool readChunk(struct Stream* stream, uint8_t* chunk, const uint32_t chunkLimit, size_t (*read)(void* context, uint8_t* bytes, size_t size), void* context, bool* ended) {
+    const size_t count = read(context, chunk, chunkLimit);
+    *ended = count == 0;
+    if(count == 0)
+        return true;
+
+    if(stream->limit - stream->size < count * 2) {
+        size_t limit = stream->limit > 0 ? stream->limit : (size_t) chunkLimit * 2;
+        while(limit - stream->size < count * 2 && limit <= SIZE_MAX / 2)
+            limit *= 2;
+
+        uint8_t* nibbles = limit - stream->size >= count * 2 ? (uint8_t*) realloc(stream->nibbles, limit) : NULL;
+        if(nibbles == NULL)
+            return false;
+
+        stream->nibbles = nibbles;
+        stream->limit = limit;
+    }
+
+    decodeInto(chunk, count, stream->nibbles + stream->size);
+    stream->size += count * 2;
+    return true;
+}
+
+/**
+ * Counts the loops of the nibbles that were read since the last time, and finds where the oldest loop that is still
+ * open starts.
+ *
+ * @param[in, out] stream The stream.
+ */
+static void countLoops(struct Stream* stream) {
+    for(; stream->counted < stream->size; ++stream->counted) {
+        const uint8_t nibble = *(stream->nibbles + stream->counted);
+
+        // A loop end without a loop start is left for the compiler to reject.
+        if(nibble == NIB_LOOP_START)
+            ++stream->depth;
+        else if(nibble == NIB_LOOP_END && stream->depth > 0)
+            --stream->depth;
+
+        if(stream->depth == 0)
+            stream->closed = stream->counted + 1;
+    }
+}
+
+/**
+ * Compiles the nibbles of a stream that are before the oldest loop that is still open, and loads them into a
+ * virtual machine without resetting it, so that they run from where the previous ones stopped.
+ *
+ * @param[in, out] vm The virtual machine.
+ * @param[in, out] stream The stream.
+ * @param[in] size The amount of nibbles to compile.
+ *
+ * @return NIB_OK, or the reason why the nibbles could not be loaded.
+ */
+static enum NIB_STATUS loadNibbles(nib_vm* vm, struct Stream* stream, const size_t size) {
+    const enum NIB_STATUS status = compile(stream->nibbles, size, &vm->program, &vm->programSize, &vm->idioms, &vm->errorIndex);
+    if(status != NIB_OK) {
+        vm->errorIndex += stream->inputIndex;
+        return status;
+    }
+
+    // The operations report the input index inside the whole script, including the OP_END operation.
+    for(uint32_t i = 0; i <= vm->programSize; ++i)
+        (vm->program + i)->inputIndex += stream->inputIndex;
+
+    // If the last move was the end of the previous program, the operation after it starts this one.
+    if(vm->tape.operation == stream->lastMove && (stream->lastMove + 1)->type == OP_END)
+        *(stream->lastMove + 1) = *vm->program;
+
+    // The native code belongs to the previous nibbles.
+    freeJit(vm);
+    measureLoops(vm);
+    vm->programIndex = 0;
+    vm->status = NIB_OK;
+    return NIB_OK;
+}
+
+enum NIB_STATUS nibRunStream(nib_vm* vm, size_t (*read)(void* context, uint8_t* bytes, size_t size), void* context, const uint64_t maxSteps) {
+    // The profile is left out, as it belongs to a single program.
+    prepareLoad(vm);
+    nibReset(vm);
+
+    struct Stream stream;
+    memset(&stream, 0, sizeof(stream));
+    const uint32_t chunkLimit = vm->options.bufferSize;
+    uint8_t* chunk = (uint8_t*) malloc(chunkLimit);
+
+    uint64_t steps = maxSteps == 0 ? UINT64_MAX : maxSteps;
+    const double deadline = vm->options.timeLimit != 0 ? profileClock() + vm->options.timeLimit / 1000.0 : 0;
+    enum NIB_STATUS status = chunk != NULL ? NIB_OK : NIB_ERROR_MEMORY;
+    bool ended = false;
+
+    while(status == NIB_OK && !ended) {
+        // Whatever is left once the script ends must be compiled, which rejects the loops that are still open.
+        if(!readChunk(&stream, chunk, chunkLimit, read, context, &ended)) {
+            status = NIB_ERROR_MEMORY;
+            break;
+        }
+
+        countLoops(&stream);
+        const size_t size = ended ? stream.size : stream.closed;
+        if(size == 0)
+            continue;
+
+        status = loadNibbles(vm, &stream, size);
+        if(status == NIB_OK && vm->programSize > 0) {
+            status = runProgram(vm, steps, deadline);
+            steps = vm->steps;
+
+            if(vm->tape.operation != NULL && vm->tape.operation != stream.lastMove) {
+                *(stream.lastMove + 1) = *(vm->tape.operation + 1);
+                vm->tape.operation = stream.lastMove;
+            }
+        }
+
+        // Only the nibbles from the oldest loop that is still open are kept.
+        memmove(stream.nibbles, stream.nibbles + size, stream.size - size);
+        stream.size -= size;
+        stream.counted -= size;
+        stream.closed = 0;
+        stream.inputIndex += size;
+    }
+
+    free(chunk);
+    free(stream.nibbles);
+
+    // The last part of the script can't be run again on its own.
+    vm->tape.operation = NULL;
+    freeJit(vm);
+    freeAll(OPERATION, 1, &vm->program);
+    vm->programSize = 0;
+    vm->programIndex = 0;
+    vm->status = NIB_ERROR_NO_SCRIPT;
+    return status;
+}
@@ -0,0 +1,545 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Needed for MAP_ANONYMOUS and sigaction() when compiling in strict C11 mode.
+#define _DEFAULT_SOURCE
+
+#include "nib.h"
+
+#if defined(NIB_GUARD_PAGES) && defined(_WIN32)
+#define NIB_GUARD_PAGES_WINDOWS
+#include <windows.h>
+#elif defined(NIB_GUARD_PAGES)
+#define NIB_GUARD_PAGES_POSIX
+#include <signal.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#endif
+
+// The amount of entries in the page directory, and in every page table.
+#define PAGE_TABLE_SIZE ((size_t) 1 << NIB_PAGE_TABLE_BITS)
+
+/**
+ * Sets the width of the values of a data array, and its memory limit.
+ *
+ * @param[out] tape The data array.
+ * @param[in] options The options of the virtual machine.
+ */
+static void setupValues(struct Tape* tape, const struct NibOptions* options) {
+    tape->cellSize = options->cellBits / 8;
+
+    // The limit is kept as an amount of values, which is at least one.
+    const uint64_t maxMemory = options->maxMemory;
+    if(maxMemory == 0 || maxMemory / tape->cellSize > SIZE_MAX)
+        tape->memoryLimit = SIZE_MAX;
+    else tape->memoryLimit = maxMemory >= tape->cellSize ? (size_t) (maxMemory / tape->cellSize) : 1;
+    tape->limitReached = false;
+}
+
+uint8_t* getPage(struct Tape* tape, const size_t dataIndex, const bool allocate) {
+    uint8_t*** table = tape->pages + (dataIndex >> (NIB_PAGE_BITS + NIB_PAGE_TABLE_BITS));
+    if(*table == NULL) {
+        if(!allocate)
+            return NULL;
+
+        *table = (uint8_t**) calloc(PAGE_TABLE_SIZE, sizeof(uint8_t*));
+        if(*table == NULL)
+            return NULL;
+    }
+
+    // The pages are filled with 0 when they are allocated, just like the contiguous data array when it grows.
+    uint8_t** page = *table + ((dataIndex >> NIB_PAGE_BITS) & (PAGE_TABLE_SIZE - 1));
+    if(*page == NULL && allocate) {
+        if(NIB_PAGE_SIZE > tape->memoryLimit - tape->pageValues) {
+            tape->limitReached = true;
+            return NULL;
+        }
+
+        *page = (uint8_t*) calloc(NIB_PAGE_SIZE, tape->cellSize);
+        if(*page != NULL)
+            tape->pageValues += NIB_PAGE_SIZE;
+    }
+    return *page;
+}
+
+/**
+ * Makes the first page the current page of a paged data array, and allocates it if needed.
+ *
+ * @param[in, out] tape The paged data array.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+static bool enterFirstPage(struct Tape* tape) {
+    uint8_t* page = getPage(tape, 0, true);
+    if(page == NULL)
+        return false;
+
+    tape->cells = page;
+    tape->pageStart = 0;
+    return true;
+}
+
+void enterPage(nib_vm* vm, const size_t dataIndex, const uint64_t inputIndex) {
+    struct Tape* tape = &vm->tape;
+
+    // Negative data indexes wrap around, so they are past the end as well.
+    if(dataIndex >= NIB_PAGED_LIMIT)
+        raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, inputIndex);
+
+    uint8_t* page = getPage(tape, dataIndex, true);
+    if(page == NULL)
+        raiseError(vm, NIB_ERROR_MEMORY, inputIndex);
+
+    // Point to where data index 0 would be, so that the interpreters keep using cells + index on every page.
+    tape->pageStart = dataIndex & ~(NIB_PAGE_SIZE - 1);
+    tape->cells = (uint8_t*) ((uintptr_t) page - tape->pageStart * tape->cellSize);
+}
+
+/**
+ * Frees the pages and the page tables of a paged data array, but not its page directory.
+ *
+ * @param[in, out] tape The paged data array.
+ */
+static void freePages(struct Tape* tape) {
+    for(size_t i = 0; i < PAGE_TABLE_SIZE; ++i) {
+        uint8_t** table = *(tape->pages + i);
+        if(table == NULL)
+            continue;
+
+        for(size_t j = 0; j < PAGE_TABLE_SIZE; ++j)
+            free(*(table + j));
+        free(table);
+        *(tape->pages + i) = NULL;
+    }
+
+    tape->cells = NULL;
+    tape->pageValues = 0;
+}
+
+/**
+ * Allocates a paged data array, along with its first page.
+ *
+ * @param[out] tape The paged data array.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+static bool setupPages(struct Tape* tape) {
+    tape->pages = (uint8_t***) calloc(PAGE_TABLE_SIZE, sizeof(uint8_t**));
+    if(tape->pages == NULL)
+        return false;
+
+    tape->size = 0;
+    tape->stepSize = 0;
+    tape->operation = NULL;
+    tape->pageValues = 0;
+
+    // The first page is always allocated.
+    if(tape->memoryLimit < NIB_PAGE_SIZE)
+        tape->memoryLimit = NIB_PAGE_SIZE;
+
+    return enterFirstPage(tape);
+}
+
+/**
+ * Fills a paged data array with 0 again, by freeing all of its pages and allocating the first one again.
+ *
+ * @param[in, out] tape The paged data array.
+ *
+ * @return Whether or not the memory could be allocated.
+ */
+static bool resetPages(struct Tape* tape) {
+    freePages(tape);
+    tape->limitReached = false;
+    return enterFirstPage(tape);
+}
+
+/**
+ * Frees a paged data array.
+ *
+ * @param[in, out] tape The paged data array.
+ */
+static void freePagedTape(struct Tape* tape) {
+    freePages(tape);
+    free(tape->pages);
+    tape->pages = NULL;
+}
+
+#ifdef NIB_GUARD_PAGES
+
+// The size of each guard around the data array, in bytes. Unsafe moves are not checked, but the first value that is
+// used after them is at most a signed 32-bit move or offset from a data index that was checked. The guards hold that
+// many values.
+#define TAPE_GUARD_SIZE(tape) (((size_t) INT32_MAX + 1) * (tape)->cellSize)
+// The size of the whole reserved region, in bytes: the guard before the data array, the reserved values, and the
+// guard after the data array.
+#define TAPE_REGION_SIZE(tape) (TAPE_GUARD_SIZE(tape) + (tape)->reserved * (tape)->cellSize + TAPE_GUARD_SIZE(tape))
+
+/**
+ * Handles an access to a value that is not committed, if it is inside the reserved region of the virtual machine
+ * that is running on the current thread.
+ *
+ * Values that are past the end of the data array are committed. Values that are at a negative data index, or
+ * inside one of the guards, stop the run with an error.
+ *
+ * @param[in] address The address that was accessed.
+ *
+ * @return Whether or not the access can be retried. If not, the access was not caused by the data array.
+ */
+static bool handleAccess(const uint8_t* address) {
+    nib_vm* vm = runningVm;
+    if(vm == NULL)
+        return false;
+
+    // Paged data arrays have no reserved region, so they never cause an access to fail.
+    struct Tape* tape = &vm->tape;
+    if(tape->region == NULL)
+        return false;
+    if(address < tape->region || address >= tape->region + TAPE_REGION_SIZE(tape))
+        return false;
+    if(address >= tape->cells && address < tape->cells + tape->size * tape->cellSize)
+        return false;
+
+    // Every OP_MOVE is followed by an operation, as the program always ends with OP_END.
+    const uint64_t inputIndex = tape->operation != NULL ? (tape->operation + 1)->inputIndex : 0;
+
+    if(address < tape->cells)
+        raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, inputIndex);
+
+    // Past the reserved values, the data index is out of bounds, unless only enough for the memory limit was
+    // reserved, which it's then past.
+    const size_t dataIndex = (size_t) (address - tape->cells) / tape->cellSize;
+    if(dataIndex >= tape->reserved)
+        raiseError(vm, dataIndex >= tape->limit ? NIB_ERROR_OUT_OF_BOUNDS : NIB_ERROR_MEMORY_LIMIT, inputIndex);
+    if(!growTape(tape, dataIndex))
+        raiseError(vm, NIB_ERROR_MEMORY, inputIndex);
+
+    return true;
+}
+
+#ifdef NIB_GUARD_PAGES_POSIX
+
+// The handlers that were replaced, which still handle the accesses that are not caused by a data array.
+static struct sigaction previousSegvAction;
+static struct sigaction previousBusAction;
+
+/**
+ * Handles a SIGSEGV or SIGBUS signal.
+ *
+ * @param[in] signal The signal.
+ * @param[in] info The signal information, which contains the address that was accessed.
+ * @param[in] context The context of the thread.
+ */
+static void handleSignal(int signal, siginfo_t* info, void* context) {
+    if(handleAccess((const uint8_t*) info->si_addr))
+        return;
+
+    const struct sigaction* previous = signal == SIGSEGV ? &previousSegvAction : &previousBusAction;
+
+    if(previous->sa_flags & SA_SIGINFO) {
+        previous->sa_sigaction(signal, info, context);
+    } else if(previous->sa_handler != SIG_DFL && previous->sa_handler != SIG_IGN) {
+        previous->sa_handler(signal);
+    } else {
+        // Restore the default action and return, so that the access is retried and terminates the process.
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = SIG_DFL;
+        sigemptyset(&action.sa_mask);
+        sigaction(signal, &action, NULL);
+    }
+}
+
+/**
+ * Installs the signal handlers, unless they were already installed. They are shared by all virtual machines, so
+ * they are installed once and never removed.
+ */
+static void installHandlers(void) {
+    // 0 if not installed, 1 while being installed, and 2 once installed.
+    static atomic_int state = 0;
+    int expected = 0;
+
+    if(!atomic_compare_exchange_strong(&state, &expected, 1)) {
+        // Another thread may still be installing them, and they must be ready before any data array is used.
+        while(atomic_load(&state) != 2);
+        return;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = handleSignal;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+
+    // Some systems raise SIGBUS instead of SIGSEGV when accessing a page that has no permissions.
+    sigaction(SIGSEGV, &action, &previousSegvAction);
+    sigaction(SIGBUS, &action, &previousBusAction);
+
+    atomic_store(&state, 2);
+}
+
+#else
+
+/**
+ * Handles an exception.
+ *
+ * @param[in] exception The exception, which contains the address that was accessed.
+ *
+ * @return Whether to retry the access, or to let other handlers deal with the exception.
+ */
+static LONG WINAPI handleException(PEXCEPTION_POINTERS exception) {
+    const PEXCEPTION_RECORD record = exception->ExceptionRecord;
+
+    if(record->ExceptionCode == EXCEPTION_ACCESS_VIOLATION && record->NumberParameters >= 2 && handleAccess((const uint8_t*) record->ExceptionInformation[1]))
+        return EXCEPTION_CONTINUE_EXECUTION;
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+/**
+ * Adds the exception handler, unless it was already added. It is shared by all virtual machines, so it is added
+ * once and never removed.
+ */
+static void installHandlers(void) {
+    // 0 if not added, 1 while being added, and 2 once added.
+    static volatile LONG state = 0;
+
+    if(InterlockedCompareExchange(&state, 1, 0) != 0) {
+        // Another thread may still be adding it, and it must be ready before any data array is used.
+        while(InterlockedCompareExchange(&state, 2, 2) != 2);
+        return;
+    }
+
+    AddVectoredExceptionHandler(1, handleException);
+    InterlockedExchange(&state, 2);
+}
+
+#endif
+
+bool setupTape(struct Tape* tape, const struct NibOptions* options) {
+    setupValues(tape, options);
+    if(options->paged)
+        return setupPages(tape);
+
+#ifdef NIB_GUARD_PAGES_POSIX
+    const uint32_t pageSize = (uint32_t) sysconf(_SC_PAGESIZE);
+#else
+    SYSTEM_INFO system;
+    GetSystemInfo(&system);
+    const uint32_t pageSize = (uint32_t) system.dwPageSize;
+#endif
+
+    // Only whole pages can be committed, and every page holds a whole amount of values. The data array holds a power
+    // of two of values, so that the JIT can check data indexes with a shift.
+    const uint32_t memStepSize = options->memStepSize;
+    const uint32_t pageValues = pageSize / tape->cellSize;
+
+    tape->limit = pageValues;
+    while(tape->limit < NIB_TAPE_LIMIT / tape->cellSize && tape->limit * tape->cellSize < options->reservedMemory)
+        tape->limit *= 2;
+
+    if(tape->memoryLimit > tape->limit)
+        tape->memoryLimit = tape->limit;
+    else tape->memoryLimit = (tape->memoryLimit + pageValues - 1) / pageValues * pageValues;
+
+    // The values past the memory limit are never committed, so only enough for the limit is reserved.
+    tape->reserved = pageValues;
+    while(tape->reserved < tape->memoryLimit)
+        tape->reserved *= 2;
+
+#ifdef NIB_GUARD_PAGES_POSIX
+    void* reserved = mmap(NULL, TAPE_REGION_SIZE(tape), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(reserved == MAP_FAILED)
+        return false;
+    tape->region = (uint8_t*) reserved;
+#else
+    tape->region = (uint8_t*) VirtualAlloc(NULL, TAPE_REGION_SIZE(tape), MEM_RESERVE, PAGE_NOACCESS);
+    if(tape->region == NULL)
+        return false;
+#endif
+
+    installHandlers();
+
+    tape->cells = tape->region + TAPE_GUARD_SIZE(tape);
+    tape->size = 0;
+    tape->stepSize = (memStepSize > UINT32_MAX - pageSize ? UINT32_MAX / pageSize * pageSize : (memStepSize + pageSize - 1) / pageSize * pageSize) / tape->cellSize;
+    tape->operation = NULL;
+
+    return growTape(tape, 0);
+}
+
+bool growTape(struct Tape* tape, const size_t dataIndex) {
+    if(dataIndex >= tape->memoryLimit) {
+        tape->limitReached = true;
+        return false;
+    }
+
+    // Commit as many steps as needed, as a single move can skip over several of them. The memory limit is below the
+    // end of the data array.
+    size_t newSize = tape->size + ((dataIndex - tape->size) / tape->stepSize + 1) * tape->stepSize;
+    if(newSize > tape->memoryLimit)
+        newSize = tape->memoryLimit;
+
+    // The pages are filled with 0 by the system when they are first used.
+    uint8_t* start = tape->cells + tape->size * tape->cellSize;
+    const size_t length = (newSize - tape->size) * tape->cellSize;
+#ifdef NIB_GUARD_PAGES_POSIX
+    if(mprotect(start, length, PROT_READ | PROT_WRITE) != 0)
+        return false;
+#else
+    if(VirtualAlloc(start, length, MEM_COMMIT, PAGE_READWRITE) == NULL)
+        return false;
+#endif
+
+    tape->size = newSize;
+    return true;
+}
+
+bool resetTape(struct Tape* tape) {
+    if(tape->pages != NULL)
+        return resetPages(tape);
+
+    tape->operation = NULL;
+    tape->limitReached = false;
+
+    // A single step is cheaper to clear than to commit again.
+    if(tape->size <= tape->stepSize) {
+        memset(tape->cells, 0, tape->size * tape->cellSize);
+        return true;
+    }
+
+    // Mapping the pages again gives their memory back, and they are filled with 0 when they are committed again.
+#ifdef NIB_GUARD_PAGES_POSIX
+    if(mmap(tape->cells, tape->size * tape->cellSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED)
+        return false;
+#else
+    if(!VirtualFree(tape->cells, tape->size * tape->cellSize, MEM_DECOMMIT))
+        return false;
+#endif
+
+    tape->size = 0;
+    return growTape(tape, 0);
+}
+
+void freeTape(struct Tape* tape) {
+    if(tape->pages != NULL) {
+        freePagedTape(tape);
+        return;
+    }
+
+    if(tape->region == NULL)
+        return;
+
+#ifdef NIB_GUARD_PAGES_POSIX
+    munmap(tape->region, TAPE_REGION_SIZE(tape));
+#else
+    VirtualFree(tape->region, 0, MEM_RELEASE);
+#endif
+
+    tape->region = NULL;
+    tape->cells = NULL;
+    tape->size = 0;
+}
+
+#else
+
+bool setupTape(struct Tape* tape, const struct NibOptions* options) {
+    setupValues(tape, options);
+    if(options->paged)
+        return setupPages(tape);
+
+    // The memory step size is turned into an amount of values. The first step is cut short by the memory limit.
+    const uint32_t stepSize = options->memStepSize >= tape->cellSize ? options->memStepSize / tape->cellSize : 1;
+    const size_t size = stepSize < tape->memoryLimit ? stepSize : tape->memoryLimit;
+    tape->cells = (uint8_t*) calloc(size, tape->cellSize);
+    if(tape->cells == NULL)
+        return false;
+
+    tape->size = size;
+    tape->stepSize = stepSize;
+    tape->operation = NULL;
+
+    return true;
+}
+
+bool growTape(struct Tape* tape, const size_t dataIndex) {
+    if(dataIndex >= tape->memoryLimit) {
+        tape->limitReached = true;
+        return false;
+    }
+
+    // Allocate as many steps as needed, as a single move can skip over several of them, but not past the memory
+    // limit. Sizes that overflow are too large to allocate anyway.
+    size_t newSize = tape->size + ((dataIndex - tape->size) / tape->stepSize + 1) * tape->stepSize;
+    if(newSize <= dataIndex || newSize > SIZE_MAX / tape->cellSize)
+        return false;
+    if(newSize > tape->memoryLimit)
+        newSize = tape->memoryLimit;
+
+    uint8_t* cells = (uint8_t*) realloc(tape->cells, newSize * tape->cellSize);
+    if(cells == NULL)
+        return false;
+
+    memset(cells + tape->size * tape->cellSize, 0, (newSize - tape->size) * tape->cellSize);
+    tape->cells = cells;
+    tape->size = newSize;
+
+    return true;
+}
+
+bool resetTape(struct Tape* tape) {
+    if(tape->pages != NULL)
+        return resetPages(tape);
+
+    tape->operation = NULL;
+    tape->limitReached = false;
+
+    // Give back the memory past the first step. Shrinking keeps the values if it fails, so they are cleared anyway.
+    if(tape->size > tape->stepSize) {
+        uint8_t* cells = (uint8_t*) realloc(tape->cells, tape->stepSize * tape->cellSize);
+        if(cells != NULL) {
+            tape->cells = cells;
+            tape->size = tape->stepSize;
+        }
+    }
+
+    memset(tape->cells, 0, tape->size * tape->cellSize);
+    return true;
+}
+
+void freeTape(struct Tape* tape) {
+    if(tape->pages != NULL) {
+        freePagedTape(tape);
+        return;
+    }
+
+    freeAll(UINT8, 1, &tape->cells);
+    tape->size = 0;
+}
+
+#endif
@@ -0,0 +1,35 @@
+# Runs the scripts of the corpus that have an expected output for a width, NAME.BITS.out, with --cell-bits BITS and
+# every engine, and checks the output. The scripts are also transpiled with that width when CC is given.
+
+include(${CMAKE_CURRENT_LIST_DIR}/common.cmake)
+
+set(OPTION_SETS "" "-s" "-p")
+
+file(GLOB outputs ${CORPUS}/*.out)
+foreach(output ${outputs})
+    get_filename_component(expected ${output} NAME)
+    string(REGEX REPLACE "^(.*)\\.([0-9]+)\\.out$" "\\1;\\2" parts ${expected})
+    list(GET parts 0 name)
+    list(GET parts 1 bits)
+    file(COPY ${output} DESTINATION ${WORK})
+    nib_pack(${name})
+
+    set(index 0)
+    foreach(optionSet IN LISTS OPTION_SETS)
+        separate_arguments(options UNIX_COMMAND "${optionSet}")
+
+        foreach(engine classic threaded jit)
+            nib_run(${name} ${name}.${bits}.${index}.${engine} result ${options} --cell-bits ${bits} -e ${engine})
+            nib_compare("${name}.b with '${optionSet}', ${bits} bits and ${engine}" ${expected} "exit code 0: "
+                ${name}.${bits}.${index}.${engine} "${result}")
+        endforeach()
+
+        if(DEFINED CC AND NOT optionSet STREQUAL "-p")
+            nib_transpile(${name} ${name}.${bits}.${index} ${options} --cell-bits ${bits})
+            nib_execute(${name} ${name}.${bits}.${index}.transpiled result ${WORK}/${name}.${bits}.${index}.exe)
+            nib_compare("${name}.b with '${optionSet}', ${bits} bits and --emit-c" ${expected} "exit code 0: "
+                ${name}.${bits}.${index}.transpiled "${result}")
+        endif()
+        math(EXPR index "${index} + 1")
+    endforeach()
+endforeach()
@@ -0,0 +1,62 @@
+# Helpers shared by the tests, which are run as scripts by CTest with these variables:
+#
+# NIB    - The interpreter.
+# PACK   - The nib-pack tool, which converts the BF scripts of the corpus to NIB.
+# CORPUS - The directory of the corpus. Every NAME.b script reads NAME.in, or no input if there is none.
+# WORK   - The directory that the scripts and their outputs are written to, which is different for every test.
+# CC     - The C compiler that builds the transpiled scripts, if they are tested.
+
+file(MAKE_DIRECTORY ${WORK})
+file(WRITE ${WORK}/empty.in "")
+
+# Converts a script of the corpus to NIB.
+function(nib_pack name)
+    execute_process(COMMAND ${PACK} ${CORPUS}/${name}.b -o ${WORK}/${name}.nib RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Could not pack ${name}.b")
+    endif()
+endfunction()
+
+# Transpiles a script of the corpus to C with the given options, and builds it as WORK/PROGRAM.exe.
+function(nib_transpile name program)
+    execute_process(COMMAND ${NIB} ${WORK}/${name}.nib ${ARGN} --emit-c ${WORK}/${program}.c RESULT_VARIABLE code)
+    if(NOT code EQUAL 0)
+        message(FATAL_ERROR "Could not transpile ${name}.b with '${ARGN}'")
+    endif()
+    execute_process(COMMAND ${CC} ${WORK}/${program}.c -o ${WORK}/${program}.exe RESULT_VARIABLE code
+        ERROR_VARIABLE errors)
+    if(NOT code EQUAL 0)
+        message(FATAL_ERROR "Could not build ${name}.b with '${ARGN}': ${errors}")
+    endif()
+endfunction()
+
+# Runs a command with the input of a script of the corpus. The output is written to WORK/OUTPUT, and the exit code and
+# errors are stored in RESULT.
+function(nib_execute name output result)
+    set(input ${CORPUS}/${name}.in)
+    if(NOT EXISTS ${input})
+        set(input ${WORK}/empty.in)
+    endif()
+
+    execute_process(COMMAND ${ARGN} INPUT_FILE ${input} OUTPUT_FILE ${WORK}/${output}
+        ERROR_VARIABLE errors RESULT_VARIABLE code TIMEOUT 10)
+    set(${result} "exit code ${code}: ${errors}" PARENT_SCOPE)
+endfunction()
+
+# Runs a script of the corpus with its input and the given options, like nib_execute().
+function(nib_run name output result)
+    nib_execute(${name} ${output} executed ${NIB} ${WORK}/${name}.nib ${ARGN})
+    set(${result} "${executed}" PARENT_SCOPE)
+endfunction()
+
+# Fails the test if two runs wrote different outputs, or stopped differently.
+function(nib_compare description expectedOutput expectedResult output result)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK}/${expectedOutput} ${WORK}/${output}
+        RESULT_VARIABLE different)
+    if(different)
+        message(SEND_ERROR "${description}: the output differs from ${expectedOutput}")
+    endif()
+    if(NOT result STREQUAL expectedResult)
+        message(SEND_ERROR "${description}: expected '${expectedResult}', got '${result}'")
+    endif()
+endfunction()
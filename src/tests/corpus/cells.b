@@ -0,0 +1,16 @@
+Each line writes Y or N depending on the width of the values and ends where it started with every value cleared
+Whether 256 is kept
+++++++++++++++++[>++++++++++++++++<-]>>++++++[<<+++++++++++++>>-]<[<+++++++++++>[-]]<.[-]
+Whether 65536 is kept
+++++++++++++++++[>++++++++++++++++<-]>[>>++++++++++++++++[<++++++++++++++++>-]<<-]>>++++++[<<<+++++++++++++>>>-]<[<<+++++++++++>>[-]]<<.[-]
+Writes 321 which is A in its lowest 8 bits
+++++++++++++++++[>++++++++++++++++<-]+++++[>+++++++++++++<-]>.[-]<
+Writes E if reading past the end of the input sets all bits
+,+[>+<[-]]>>+++[<+++++++++++++++++++++++>-]<.[-]<
+Whether a multiplication of 128 by 2 keeps 256
+++++++++[>++++++++++++++++<-]>[->++<]>>++++++[<<<+++++++++++++>>>-]<[<<+++++++++++>>[-]]<<.[-]
+Writes M if a multiplication of all bits by 3 wraps around to minus 3
+-[->+++<]>+++[<+>[-]]>+++++++[<<+++++++++++>>-]<<.[-]
+Whether a scan skips values of 256
+++++++++++++++++[>++++++++++++++++>++++++++++++++++<<-]>>>+<<[>]+<[<]>>>>>++++++[<<<<<+++++++++++++>>>>>-]<[<<<<+++++++++++>>>>[-]]<[-]<[-]<[-]<.[-]
+++++++++++.
@@ -0,0 +1,10 @@
+Multiplication whose targets are reached in decreasing offset order
+>>++++++++[<++++++++<++>>-]<.<+++++++++++++++++.
+Nested loops
+>>>+++[>+++[>+++<-]<-]>>.
+A balanced loop that writes and a clear loop
+>+++++[->+<.]>[-]
+Scans in both directions
+<<<<[-]+>+>+>+>[-]<<<<[>]>[<]>.
+A loop that moves and never balances
+++++[>++[>+<-]<-]>>.
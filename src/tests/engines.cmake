@@ -0,0 +1,27 @@
+# Runs every script of the corpus with the threaded engine and the JIT, and compares them with the classic engine.
+#
+# The option sets cover the jumps that the JIT encodes by hand: the ends of loops that are left, moves to a negative
+# index in safe mode, and moves past the memory limit, or past the end of the data array, in safe mode.
+
+include(${CMAKE_CURRENT_LIST_DIR}/common.cmake)
+
+set(OPTION_SETS "" "-s" "--max-memory 65536" "-s --max-memory 65536" "--max-steps 200" "-p")
+
+file(GLOB scripts ${CORPUS}/*.b)
+foreach(script ${scripts})
+    get_filename_component(name ${script} NAME_WE)
+    nib_pack(${name})
+
+    set(index 0)
+    foreach(optionSet IN LISTS OPTION_SETS)
+        separate_arguments(options UNIX_COMMAND "${optionSet}")
+        nib_run(${name} ${name}.${index}.classic expected ${options} -e classic)
+
+        foreach(engine threaded jit)
+            nib_run(${name} ${name}.${index}.${engine} result ${options} -e ${engine})
+            nib_compare("${name}.b with '${optionSet}' and ${engine}" ${name}.${index}.classic "${expected}"
+                ${name}.${index}.${engine} "${result}")
+        endforeach()
+        math(EXPR index "${index} + 1")
+    endforeach()
+endforeach()
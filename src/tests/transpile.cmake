@@ -0,0 +1,24 @@
+# Transpiles every script of the corpus to C with --emit-c, builds it with CC, and compares the program with the
+# classic engine, including its errors and exit code.
+
+include(${CMAKE_CURRENT_LIST_DIR}/common.cmake)
+
+set(OPTION_SETS "" "-s")
+
+file(GLOB scripts ${CORPUS}/*.b)
+foreach(script ${scripts})
+    get_filename_component(name ${script} NAME_WE)
+    nib_pack(${name})
+
+    set(index 0)
+    foreach(optionSet IN LISTS OPTION_SETS)
+        separate_arguments(options UNIX_COMMAND "${optionSet}")
+        nib_run(${name} ${name}.${index}.classic expected ${options} -e classic)
+        nib_transpile(${name} ${name}.${index} ${options})
+
+        nib_execute(${name} ${name}.${index}.transpiled result ${WORK}/${name}.${index}.exe)
+        nib_compare("${name}.b with '${optionSet}' and --emit-c" ${name}.${index}.classic "${expected}"
+            ${name}.${index}.transpiled "${result}")
+        math(EXPR index "${index} + 1")
+    endforeach()
+endforeach()
@@ -0,0 +1,116 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "../libnib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Enough virtual machines for a process that hosts one for every script it runs, which must all fit at once.
+#define VM_COUNT 4096u
+
+// "+>+++++[<+>-]<." encoded to nibbles, which writes a value of 6.
+static const uint8_t SCRIPT[] = { 0x23, 0x22, 0x22, 0x24, 0x62, 0x35, 0x16, 0x08 };
+
+/**
+ * Keeps the last value that a virtual machine wrote.
+ *
+ * @param[in] context Where to keep the value.
+ * @param[in] bytes The bytes to write.
+ * @param[in] size The amount of bytes to write.
+ *
+ * @return true, as the bytes are always written.
+ */
+static bool writeOutput(void* context, const uint8_t* bytes, const size_t size) {
+    if(size > 0)
+        *(uint8_t*) context = *(bytes + size - 1);
+    return true;
+}
+
+/**
+ * Reads nothing, as the script doesn't read.
+ *
+ * @param[in] context Not used.
+ * @param[out] bytes Not used.
+ * @param[in] size Not used.
+ *
+ * @return 0, as there is no input.
+ */
+static size_t readInput(void* context, uint8_t* bytes, const size_t size) {
+    (void) context;
+    (void) bytes;
+    (void) size;
+    return 0;
+}
+
+/**
+ * Creates many virtual machines with their default data arrays, and with wider values or a memory limit, keeps them
+ * all at once, and runs a script on every one of them.
+ *
+ * @return 0 if every virtual machine could be created and ran the script, 1 otherwise.
+ */
+int main(void) {
+    nib_vm** vms = (nib_vm**) calloc(VM_COUNT, sizeof(nib_vm*));
+    uint8_t* outputs = (uint8_t*) calloc(VM_COUNT, 1);
+    struct NibIo* ios = (struct NibIo*) calloc(VM_COUNT, sizeof(struct NibIo));
+    if(vms == NULL || outputs == NULL || ios == NULL) {
+        fprintf(stderr, "Could not allocate memory for the test\n");
+        return 1;
+    }
+
+    int result = 0;
+    for(uint32_t index = 0; index < VM_COUNT && result == 0; ++index) {
+        struct NibOptions options;
+        nibDefaultOptions(&options);
+        options.bufferSize = 64;
+        if(index % 4 == 1)
+            options.cellBits = 32;
+        else if(index % 4 == 2)
+            options.maxMemory = 65536;
+
+        struct NibIo* io = ios + index;
+        io->write = writeOutput;
+        io->read = readInput;
+        io->context = outputs + index;
+
+        *(vms + index) = nibCreate(&options, io);
+        if(*(vms + index) == NULL) {
+            fprintf(stderr, "Could not create virtual machine %u\n", index);
+            result = 1;
+        }
+    }
+
+    for(uint32_t index = 0; index < VM_COUNT && result == 0; ++index) {
+        nib_vm* vm = *(vms + index);
+        if(nibLoad(vm, SCRIPT, sizeof(SCRIPT)) != NIB_OK || nibRun(vm, 0) != NIB_OK || *(outputs + index) != 6) {
+            fprintf(stderr, "Virtual machine %u could not run the script\n", index);
+            result = 1;
+        }
+    }
+
+    for(uint32_t index = 0; index < VM_COUNT; ++index)
+        nibDestroy(*(vms + index));
+    free(ios);
+    free(outputs);
+    free(vms);
+    return result;
+}
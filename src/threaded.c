@@ -0,0 +1,111 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nib.h"
+
+// GCC and Clang support labels as values, so every operation can jump straight to the handler of the next one.
+// Other compilers fall back to a switch inside a loop.
+#if defined(__GNUC__) && !defined(NIB_NO_COMPUTED_GOTO)
+#define NIB_COMPUTED_GOTO
+#endif
+
+// GCC merges the identical dispatch code at the end of the handlers, which leaves a few shared indirect jumps that
+// are much harder to predict than one jump for every handler.
+#if defined(NIB_COMPUTED_GOTO) && !defined(__clang__)
+#pragma GCC optimize("no-crossjumping")
+#endif
+
+#ifdef NIB_COMPUTED_GOTO
+#define DISPATCH_BEGIN goto *dispatchTable[operation->type];
+#define DISPATCH_END
+#define CASE(type) type:
+#define NEXT() goto *dispatchTable[(++operation)->type]
+#else
+#define DISPATCH_BEGIN for(;;) { switch(operation->type) {
+#define DISPATCH_END default: break; } }
+#define CASE(type) case type:
+#define NEXT() ++operation; break
+#endif
+
+// Tells GCC and Clang that a check rarely passes, so that its branch is moved out of the way.
+#ifdef __GNUC__
+#define UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+#define UNLIKELY(condition) (condition)
+#endif
+
+// The name of a variant of the threaded interpreter, from whether it's safe, profiled and paged, and from the width
+// of the values. The names of the 8-bit variants have no width (e.g. interpretThreadedSafelyPaged and
+// interpretThreadedSafelyPaged16). The parts are expanded before they are joined.
+#define THREADED_VARIANT_NAME(safe, profile, paged, bits) THREADED_NAME_PARTS(safe, profile, paged, bits)
+#define THREADED_NAME_PARTS(safe, profile, paged, bits) THREADED_NAME_JOIN(THREADED_NAME_SAFE_##safe, THREADED_NAME_PAGED_##paged, THREADED_NAME_PROFILE_##profile, THREADED_NAME_BITS_##bits)
+#define THREADED_NAME_JOIN(safe, paged, profile, bits) THREADED_NAME_PASTE(safe, paged, profile, bits)
+#define THREADED_NAME_PASTE(safe, paged, profile, bits) interpretThreaded##safe##paged##profile##bits
+#define THREADED_NAME_SAFE_0
+#define THREADED_NAME_SAFE_1 Safely
+#define THREADED_NAME_PROFILE_0
+#define THREADED_NAME_PROFILE_1 Profiled
+#define THREADED_NAME_PAGED_0
+#define THREADED_NAME_PAGED_1 Paged
+#define THREADED_NAME_BITS_8
+#define THREADED_NAME_BITS_16 16
+#define THREADED_NAME_BITS_32 32
+
+// Every width has the 8 variants that variants.h defines, listed by whether they are safe, profiled and paged. They
+// are in the order of the dispatch table: by whether the data array is paged, whether the run is profiled, and
+// whether it is safe.
+#define THREADED_VARIANTS(VARIANT, bits) \
+    VARIANT(0, 0, 0, bits) \
+    VARIANT(1, 0, 0, bits) \
+    VARIANT(0, 1, 0, bits) \
+    VARIANT(1, 1, 0, bits) \
+    VARIANT(0, 0, 1, bits) \
+    VARIANT(1, 0, 1, bits) \
+    VARIANT(0, 1, 1, bits) \
+    VARIANT(1, 1, 1, bits)
+
+#define THREADED_CELL_BITS 8
+#include "variants.h"
+#undef THREADED_CELL_BITS
+
+// The variants for wider values are only reached through interpretThreadedWide.
+#define THREADED_CELL_BITS 16
+#include "variants.h"
+#undef THREADED_CELL_BITS
+
+#define THREADED_CELL_BITS 32
+#include "variants.h"
+#undef THREADED_CELL_BITS
+
+void interpretThreadedWide(nib_vm* vm) {
+    // Indexed by the width, then by whether the data array is paged, whether the run is profiled, and whether it
+    // is safe.
+#define THREADED_ENTRY(safe, profile, paged, bits) THREADED_VARIANT_NAME(safe, profile, paged, bits),
+    static void (* const interpreters[2][8])(nib_vm*) = {
+        { THREADED_VARIANTS(THREADED_ENTRY, 16) },
+        { THREADED_VARIANTS(THREADED_ENTRY, 32) }
+    };
+#undef THREADED_ENTRY
+
+    const size_t variant = (vm->tape.pages != NULL ? 4u : 0u) + (vm->profile != NULL ? 2u : 0u) + (vm->options.safe ? 1u : 0u);
+    interpreters[vm->tape.cellSize == 4][variant](vm);
+}
@@ -0,0 +1,301 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// This header has no include guard on purpose. It is the body of the threaded interpreter, and variants.h
+// includes it once for every variant. Before including it, the following must be defined:
+//
+// THREADED_SAFE - 1 if the interpreter is safe, 0 otherwise.
+// THREADED_PROFILE - 1 if the interpreter counts every operation that it runs, 0 otherwise.
+// THREADED_PAGED - 1 if the interpreter runs on a paged data array, 0 otherwise.
+// THREADED_CELL_BITS - The amount of bits in every value of the data array: 8, 16 or 32.
+//
+// It undefines the first three, and names the interpreter with THREADED_VARIANT_NAME from threaded.c.
+
+#define THREADED_NAME THREADED_VARIANT_NAME(THREADED_SAFE, THREADED_PROFILE, THREADED_PAGED, THREADED_CELL_BITS)
+
+#if THREADED_CELL_BITS == 8
+#define CELL uint8_t
+#define DATA(name) name
+#define LINKAGE
+#elif THREADED_CELL_BITS == 16
+#define CELL uint16_t
+#define DATA(name) name##16
+#define LINKAGE static
+#else
+#define CELL uint32_t
+#define DATA(name) name##32
+#define LINKAGE static
+#endif
+
+#if THREADED_PAGED
+#define TAPE_LIMIT NIB_PAGED_LIMIT
+#define MULTIPLY_DATA DATA(multiplyPagedData)
+#define SCAN_DATA DATA(scanPagedData)
+#define CHECK_RANGE checkPagedRange
+// Whenever the data index leaves the current page, the page that it moved to becomes the current one, so the other
+// operations use the values directly. The operation after a move uses the data index unless it is another move or
+// the end of the program, so it's the one that reports an invalid data index, just like with guard pages.
+#define ENTER_PAGE(next) \
+    if(UNLIKELY(index - pageStart >= NIB_PAGE_SIZE) && (next)->type != OP_MOVE && (next)->type != OP_END) { \
+        enterPage(vm, index, (next)->inputIndex); \
+        cells = (CELL*) tape->cells; \
+        pageStart = tape->pageStart; \
+    }
+#else
+#ifdef NIB_GUARD_PAGES
+#define TAPE_LIMIT tape->limit
+#else
+#define TAPE_LIMIT NIB_TAPE_LIMIT
+#endif
+#define MULTIPLY_DATA DATA(multiplyData)
+#define SCAN_DATA DATA(scanData)
+#define CHECK_RANGE checkRange
+#define ENTER_PAGE(next)
+#endif
+
+// Without guard pages, the unsafe interpreter checks every value that it uses, including the checks of loops. The
+// copies of balanced loops only use values around the data index that OP_RANGE checked, so checking the data index
+// is enough.
+#if !THREADED_SAFE && !THREADED_PAGED && !defined(NIB_GUARD_PAGES)
+#define CHECK_INDEX() if(index >= tape->size) goto outOfBounds
+#else
+#define CHECK_INDEX()
+#endif
+
+#if THREADED_PROFILE
+#define COUNT() ++*(executions + (operation - base))
+#define TRACK_INDEX() if(index > maxDataIndex && index < TAPE_LIMIT) maxDataIndex = index
+// The copy of a balanced loop never moves, but the original loop would reach its highest offset if it runs.
+#define TRACK_RANGE() if(*(cells + index) != 0 && index + (uint32_t) operation->count > maxDataIndex) maxDataIndex = index + (uint32_t) operation->count
+#else
+#define COUNT()
+#define TRACK_INDEX()
+#define TRACK_RANGE()
+#endif
+
+LINKAGE void THREADED_NAME(nib_vm* vm) {
+    // Keep the interpreter state in locals, so that the compiler can keep it in registers. The program always ends
+    // with OP_END, so its size is not needed.
+    struct Tape* tape = &vm->tape;
+    const struct Operation* base = vm->program;
+    const struct Operation* operation = base + vm->programIndex;
+    CELL* cells = (CELL*) tape->cells;
+    size_t index = vm->dataIndex;
+#if THREADED_PAGED
+    size_t pageStart = tape->pageStart;
+#endif
+    uint64_t steps = vm->steps;
+#if THREADED_PROFILE
+    uint64_t* executions = vm->profile->executions;
+    size_t maxDataIndex = vm->profile->maxDataIndex;
+#endif
+
+#ifdef NIB_COMPUTED_GOTO
+    static const void* const dispatchTable[] = {
+        [OP_ADD] = &&OP_ADD,
+        [OP_MOVE] = &&OP_MOVE,
+        [OP_WRITE] = &&OP_WRITE,
+        [OP_READ] = &&OP_READ,
+        [OP_LOOP_START] = &&OP_LOOP_START,
+        [OP_LOOP_END] = &&OP_LOOP_END,
+        [OP_END] = &&OP_END,
+        [OP_CLEAR] = &&OP_CLEAR,
+        [OP_MULTIPLY] = &&OP_MULTIPLY,
+        [OP_MULTIPLY_ADD] = &&OP_MULTIPLY_ADD,
+        [OP_SCAN] = &&OP_SCAN,
+        [OP_RANGE] = &&OP_RANGE
+    };
+#endif
+
+    // The run may start right after a move that left the current page, if the program was replaced since.
+    ENTER_PAGE(operation);
+
+    DISPATCH_BEGIN
+        CASE(OP_ADD) {
+            COUNT();
+            CHECK_INDEX();
+            *(cells + index + operation->offset) += (CELL) operation->count;
+            NEXT();
+        }
+        CASE(OP_MOVE) {
+            COUNT();
+#if THREADED_SAFE
+            if(operation->count < 0) {
+                // Moving to a negative index is ignored, so the data index stops at 0.
+                size_t distance = (size_t) -(int64_t) operation->count;
+                index = distance > index ? 0 : index - distance;
+            } else {
+                index += operation->count;
+#if THREADED_PAGED
+                // Moving past the end of the data array is caught when entering the page.
+#elif defined(NIB_GUARD_PAGES)
+                // Only moving past the end of the data array or past its memory limit is invalid here, which is
+                // cheaper to check than to record every move. The memory limit is never past the end.
+                if(index >= tape->memoryLimit) {
+                    if(index >= TAPE_LIMIT)
+                        goto outOfBounds;
+                    raiseError(vm, NIB_ERROR_MEMORY_LIMIT, operation->inputIndex);
+                }
+#else
+                if(index >= tape->size) {
+                    if(!growTape(tape, index))
+                        raiseError(vm, NIB_ERROR_MEMORY, operation->inputIndex);
+                    cells = (CELL*) tape->cells;
+                }
+#endif
+            }
+#elif THREADED_PAGED
+            index += operation->count;
+#elif defined(NIB_GUARD_PAGES)
+            tape->operation = operation;
+            index += operation->count;
+#else
+            size_t previousIndex = index;
+            index += operation->count;
+
+            // Only grow if the move went past the end, and not if it's still at a negative index.
+            if(operation->count > 0 && index >= tape->size && (previousIndex < tape->size || index < previousIndex)) {
+                if(!growTape(tape, index))
+                    raiseError(vm, NIB_ERROR_MEMORY, operation->inputIndex);
+                cells = (CELL*) tape->cells;
+            }
+#endif
+            ENTER_PAGE(operation + 1);
+            TRACK_INDEX();
+            NEXT();
+        }
+        CASE(OP_WRITE) {
+            COUNT();
+            CHECK_INDEX();
+            writeValue(vm, (uint8_t) *(cells + index + operation->offset));
+            NEXT();
+        }
+        CASE(OP_READ) {
+            COUNT();
+            CHECK_INDEX();
+            *(cells + index + operation->offset) = (CELL) readValue(vm);
+            NEXT();
+        }
+        CASE(OP_LOOP_START) {
+            COUNT();
+            CHECK_INDEX();
+            // Jump to the end of the loop, and skip it.
+            if(*(cells + index) == 0)
+                operation = base + operation->jump;
+            NEXT();
+        }
+        CASE(OP_LOOP_END) {
+            COUNT();
+            CHECK_INDEX();
+            // Jump to the start of the loop, and skip it as its check would pass anyway. Stop before repeating
+            // the loop if there are not enough steps left.
+            if(*(cells + index) != 0) {
+                if(steps < (uint32_t) operation->count)
+                    goto end;
+
+                steps -= (uint32_t) operation->count;
+                operation = base + operation->jump;
+            }
+            NEXT();
+        }
+        CASE(OP_END) {
+            COUNT();
+            goto end;
+        }
+        CASE(OP_CLEAR) {
+            COUNT();
+            CHECK_INDEX();
+            *(cells + index + operation->offset) = 0;
+            NEXT();
+        }
+        CASE(OP_MULTIPLY) {
+            COUNT();
+            // Skip the loop, or the multiplications if the loop must be interpreted instead.
+            if(MULTIPLY_DATA(vm, operation, index))
+                operation = base + operation->jump;
+            else operation += operation->count;
+            cells = (CELL*) tape->cells;
+            NEXT();
+        }
+        CASE(OP_MULTIPLY_ADD) {
+            COUNT();
+            // Always run by OP_MULTIPLY.
+            NEXT();
+        }
+        CASE(OP_SCAN) {
+            COUNT();
+            // Skip the loop, unless it must be interpreted instead. The data index is copied so that its address
+            // is never taken, which would keep it out of a register.
+            size_t scanIndex = index;
+            if(SCAN_DATA(vm, operation->count, &scanIndex))
+                operation = base + operation->jump;
+            index = scanIndex;
+            cells = (CELL*) tape->cells;
+            ENTER_PAGE(operation);
+            TRACK_INDEX();
+            NEXT();
+        }
+        CASE(OP_RANGE) {
+            COUNT();
+            // Skip the original loop, unless the copy can't be run. The data array may have grown.
+            if(CHECK_RANGE(vm, operation, index)) {
+                cells = (CELL*) tape->cells;
+                TRACK_RANGE();
+                operation = base + operation->jump;
+            }
+            NEXT();
+        }
+    DISPATCH_END
+
+// Without guard pages, the unsafe interpreter checks every access. With them, only the safe one checks its moves.
+// The paged interpreters check the data index when entering its page instead.
+#if !THREADED_PAGED && THREADED_SAFE == defined(NIB_GUARD_PAGES)
+outOfBounds:
+    raiseError(vm, NIB_ERROR_OUT_OF_BOUNDS, operation->inputIndex);
+#endif
+
+end:
+    // Write the state back.
+    vm->programIndex = (uint32_t) (operation - base);
+    vm->dataIndex = index;
+    vm->steps = steps;
+#if THREADED_PROFILE
+    vm->profile->maxDataIndex = maxDataIndex;
+#endif
+}
+
+#undef CELL
+#undef DATA
+#undef LINKAGE
+#undef TAPE_LIMIT
+#undef MULTIPLY_DATA
+#undef SCAN_DATA
+#undef CHECK_RANGE
+#undef ENTER_PAGE
+#undef CHECK_INDEX
+#undef COUNT
+#undef TRACK_INDEX
+#undef TRACK_RANGE
+#undef THREADED_NAME
+#undef THREADED_SAFE
+#undef THREADED_PROFILE
+#undef THREADED_PAGED
@@ -0,0 +1,379 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nib.h"
+
+// The code that every transpiled program starts with, which mirrors the buffered I/O and the error messages of
+// the interpreter. Before it, the options are defined as macros.
+static const char* const prologue =
+    "#include <stdint.h>\n"
+    "#include <stddef.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "\n"
+    "#if defined(__unix__) || defined(__APPLE__)\n"
+    "#include <unistd.h>\n"
+    "#define IS_TERMINAL() isatty(STDOUT_FILENO)\n"
+    "#define READ_INPUT(bytes, size) read(STDIN_FILENO, bytes, size)\n"
+    "#else\n"
+    "#define IS_TERMINAL() 0\n"
+    "#define READ_INPUT(bytes, size) (ptrdiff_t) fread(bytes, 1, 1, stdin)\n"
+    "#endif\n"
+    "\n"
+    "static uint8_t output[BUFFER_SIZE];\n"
+    "static size_t outputSize;\n"
+    "static uint8_t input[BUFFER_SIZE];\n"
+    "static size_t inputSize;\n"
+    "static size_t inputIndex;\n"
+    "static int inputEnded;\n"
+    "static int lineBuffered;\n"
+    "\n"
+    "static int flush(void) {\n"
+    "    int written = outputSize == 0 || (fwrite(output, 1, outputSize, stdout) == outputSize && fflush(stdout) == 0);\n"
+    "    outputSize = 0;\n"
+    "    return written;\n"
+    "}\n"
+    "\n"
+    "static void fail(const char* format, unsigned long long inputIndex) {\n"
+    "    flush();\n"
+    "    fprintf(stderr, format, inputIndex);\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n"
+    "static inline void put(CELL value) {\n"
+    "    output[outputSize++] = (uint8_t) value;\n"
+    "    if((outputSize == BUFFER_SIZE || (lineBuffered && value == '\\n')) && !flush())\n"
+    "        fail(\"Could not write the output\", 0);\n"
+    "}\n"
+    "\n"
+    "static inline CELL get(void) {\n"
+    "    if(inputIndex == inputSize) {\n"
+    "        ptrdiff_t count;\n"
+    "        if(inputEnded)\n"
+    "            return (CELL) EOF;\n"
+    "        if(!flush())\n"
+    "            fail(\"Could not write the output\", 0);\n"
+    "        count = READ_INPUT(input, BUFFER_SIZE);\n"
+    "        if(count <= 0) {\n"
+    "            inputEnded = 1;\n"
+    "            return (CELL) EOF;\n"
+    "        }\n"
+    "        inputSize = (size_t) count;\n"
+    "        inputIndex = 0;\n"
+    "    }\n"
+    "    return input[inputIndex++];\n"
+    "}\n"
+    "\n"
+    "static CELL* grow(CELL* cells, ptrdiff_t* size, ptrdiff_t index) {\n"
+    "    ptrdiff_t newSize = (index / MEM_STEP_SIZE + 1) * MEM_STEP_SIZE;\n"
+    "    CELL* grown = (CELL*) realloc(cells, (size_t) newSize * sizeof(CELL));\n"
+    "    if(grown == NULL)\n"
+    "        fail(\"Could not allocate memory\", 0);\n"
+    "    memset(grown + *size, 0, (size_t) (newSize - *size) * sizeof(CELL));\n"
+    "    *size = newSize;\n"
+    "    return grown;\n"
+    "}\n"
+    "\n"
+    "#define OUT_OF_BOUNDS(inputIndex) fail(\"Data index out of bounds at input index '%llu'\", inputIndex)\n"
+    "\n"
+    "int main(void) {\n"
+    "    ptrdiff_t size = 0;\n"
+    "    ptrdiff_t i = 0;\n"
+    "    CELL* c = grow(NULL, &size, 0);\n"
+    "\n"
+    "    lineBuffered = LINE_BUFFERED || IS_TERMINAL();\n";
+
+static const char* const epilogue =
+    "\n"
+    "    if(!flush())\n"
+    "        fail(\"Could not write the output\", 0);\n"
+    "    free(c);\n"
+    "    return 0;\n"
+    "}\n";
+
+/**
+ * Represents the state of the transpiler.
+ */
+struct Transpiler {
+    const struct Operation* program;
+    FILE* output;
+    bool safe;
+    // The mask of the bits that every value has.
+    uint32_t mask;
+    // The amount of loops that the next line is inside of.
+    uint32_t depth;
+    // The amount that the data index was moved by since it was last written to the transpiled program. Moves are
+    // only written at the ends of the loops and before scans, and other operations add this offset instead.
+    int64_t offset;
+};
+
+/**
+ * Writes a line of the transpiled program, indented to the current depth.
+ *
+ * @param[in, out] transpiler The transpiler.
+ * @param[in] format The format of the line.
+ * @param[in] ... The additional arguments for the line format.
+ */
+static void emit(struct Transpiler* transpiler, const char* format, ...) {
+    fprintf(transpiler->output, "%*s", (int) (transpiler->depth + 1) * 4, "");
+
+    va_list va;
+    va_start(va, format);
+    vfprintf(transpiler->output, format, va);
+    va_end(va);
+
+    fputc('\n', transpiler->output);
+}
+
+/**
+ * Formats the data index plus an offset, as an expression of the transpiled program.
+ *
+ * @param[out] expression The expression.
+ * @param[in] offset The offset.
+ *
+ * @return The expression.
+ */
+static const char* formatIndex(char expression[32], const int64_t offset) {
+    if(offset == 0)
+        snprintf(expression, 32, "i");
+    else if(offset > 0)
+        snprintf(expression, 32, "i + %lld", (long long) offset);
+    else snprintf(expression, 32, "i - %lld", (long long) -offset);
+
+    return expression;
+}
+
+/**
+ * Writes a check which rejects a data index that is negative, unless it can't be.
+ *
+ * The data index is never negative where the pending offset starts, as the loops that lead there checked it.
+ *
+ * @param[in, out] transpiler The transpiler.
+ * @param[in] offset The offset from the data index.
+ * @param[in] inputIndex The input index to report.
+ */
+static void emitCheck(struct Transpiler* transpiler, const int64_t offset, const uint64_t inputIndex) {
+    if(offset < 0)
+        emit(transpiler, "if(i < %lld) OUT_OF_BOUNDS(%lluu);", (long long) -offset, (unsigned long long) inputIndex);
+}
+
+/**
+ * Writes the pending offset to the data index.
+ *
+ * @param[in, out] transpiler The transpiler.
+ * @param[in] inputIndex The input index to report if the data index becomes negative.
+ */
+static void emitMove(struct Transpiler* transpiler, const uint64_t inputIndex) {
+    if(transpiler->offset == 0)
+        return;
+
+    emitCheck(transpiler, transpiler->offset, inputIndex);
+    if(transpiler->offset > 0)
+        emit(transpiler, "i += %lld;", (long long) transpiler->offset);
+    else emit(transpiler, "i -= %lld;", (long long) -transpiler->offset);
+    transpiler->offset = 0;
+}
+
+/**
+ * Writes a check which grows the data array so that it contains every value that the operations until the next
+ * loop or scan can use.
+ *
+ * @param[in, out] transpiler The transpiler.
+ * @param[in] index The index of the first operation.
+ */
+static void emitGrowth(struct Transpiler* transpiler, uint32_t index) {
+    // The safe program moves the data index after every move, and grows the data array there.
+    if(transpiler->safe)
+        return;
+
+    int64_t offset = transpiler->offset;
+    int64_t highest = offset;
+
+    for(;; ++index) {
+        const struct Operation* operation = transpiler->program + index;
+        if(operation->type == OP_LOOP_START || operation->type == OP_LOOP_END || operation->type == OP_SCAN || operation->type == OP_END)
+            break;
+
+        // The additions of a multiplication are sorted by offset, so the last one reaches the furthest.
+        int64_t reach = offset;
+        if(operation->type == OP_MOVE)
+            reach = offset += operation->count;
+        else if(operation->type == OP_MULTIPLY && operation->count > 0)
+            reach = offset + (operation + operation->count)->offset;
+
+        if(reach > highest)
+            highest = reach;
+    }
+
+    if(highest > 0)
+        emit(transpiler, "if(i + %lld >= size) c = grow(c, &size, i + %lld);", (long long) highest, (long long) highest);
+}
+
+bool nibEmitC(const nib_vm* vm, FILE* output) {
+    if(vm->program == NULL)
+        return false;
+
+    const uint32_t cellBits = vm->options.cellBits;
+    const uint32_t cellSize = cellBits / 8;
+    struct Transpiler state = { vm->program, output, vm->options.safe, UINT32_MAX >> (32 - cellBits), 0, 0 };
+    struct Transpiler* transpiler = &state;
+
+    // The memory step size is an amount of values, just like in the interpreter.
+    fprintf(output, "/* Transpiled from a NIB script by the NIB interpreter. */\n\n");
+    fprintf(output, "#define CELL uint%u_t\n", cellBits);
+    fprintf(output, "#define MEM_STEP_SIZE %u\n", vm->options.memStepSize >= cellSize ? vm->options.memStepSize / cellSize : 1);
+    fprintf(output, "#define BUFFER_SIZE %u\n", vm->options.bufferSize);
+    fprintf(output, "#define LINE_BUFFERED %d\n\n", vm->options.lineBuffered ? 1 : 0);
+    fputs(prologue, output);
+    fputc('\n', output);
+
+    emitGrowth(transpiler, 0);
+
+    // The copy of the balanced loop that was last transpiled, which is left out.
+    uint32_t copy = UINT32_MAX;
+
+    for(uint32_t index = 0; index < vm->programSize; ++index) {
+        if(index == copy) {
+            index = (vm->program + index)->jump;
+            continue;
+        }
+
+        const struct Operation* operation = vm->program + index;
+        const int64_t offset = transpiler->offset;
+        char cell[32];
+        formatIndex(cell, offset);
+
+        switch(operation->type) {
+            case OP_ADD: {
+                emitCheck(transpiler, offset, operation->inputIndex);
+                emit(transpiler, "c[%s] += %uu;", cell, (uint32_t) operation->count & transpiler->mask);
+                break;
+            }
+            case OP_MOVE: {
+                if(!transpiler->safe) {
+                    transpiler->offset += operation->count;
+                } else if(operation->count < 0) {
+                    // Moving to a negative index is ignored, so the data index stops at 0.
+                    emit(transpiler, "i = i < %d ? 0 : i - %d;", -operation->count, -operation->count);
+                } else {
+                    emit(transpiler, "i += %d;", operation->count);
+                    emit(transpiler, "if(i >= size) c = grow(c, &size, i);");
+                }
+                break;
+            }
+            case OP_WRITE: {
+                emitCheck(transpiler, offset, operation->inputIndex);
+                emit(transpiler, "put(c[%s]);", cell);
+                break;
+            }
+            case OP_READ: {
+                emitCheck(transpiler, offset, operation->inputIndex);
+                emit(transpiler, "c[%s] = get();", cell);
+                break;
+            }
+            case OP_LOOP_START: {
+                emitMove(transpiler, operation->inputIndex);
+                emit(transpiler, "while(c[i]) {");
+                ++transpiler->depth;
+                emitGrowth(transpiler, index + 1);
+                break;
+            }
+            case OP_LOOP_END: {
+                emitMove(transpiler, operation->inputIndex);
+                --transpiler->depth;
+                emit(transpiler, "}");
+                emitGrowth(transpiler, index + 1);
+                break;
+            }
+            case OP_CLEAR: {
+                emitCheck(transpiler, offset, operation->inputIndex);
+                emit(transpiler, "c[%s] = 0;", cell);
+                break;
+            }
+            case OP_MULTIPLY: {
+                // The original loop follows, and runs instead when the multiplications would move to a negative
+                // index, just like in the interpreter.
+                emitCheck(transpiler, offset, operation->inputIndex);
+
+                const int64_t lowestOffset = offset + operation->offset;
+                if(lowestOffset < 0)
+                    emit(transpiler, "if(c[%s] && i >= %lld) {", cell, (long long) -lowestOffset);
+                else emit(transpiler, "if(c[%s]) {", cell);
+                ++transpiler->depth;
+
+                for(int32_t target = 1; target <= operation->count; ++target) {
+                    const struct Operation* multiply = operation + target;
+                    char targetCell[32];
+
+                    const uint32_t factor = (uint32_t) multiply->count & transpiler->mask;
+                    if(factor == 1)
+                        emit(transpiler, "c[%s] += c[%s];", formatIndex(targetCell, offset + multiply->offset), cell);
+                    else emit(transpiler, "c[%s] += (CELL) (c[%s] * %uu);", formatIndex(targetCell, offset + multiply->offset), cell, factor);
+                }
+                emit(transpiler, "c[%s] = 0;", cell);
+
+                --transpiler->depth;
+                emit(transpiler, "}");
+                index += (uint32_t) operation->count;
+                break;
+            }
+            case OP_SCAN: {
+                // The original loop follows, and runs instead when the scan would move to a negative index.
+                emitMove(transpiler, operation->inputIndex);
+
+                if(operation->count == 1 && cellSize == 1) {
+                    emit(transpiler, "{");
+                    ++transpiler->depth;
+                    emit(transpiler, "const uint8_t* found = (const uint8_t*) memchr(c + i, 0, (size_t) (size - i));");
+                    emit(transpiler, "i = found != NULL ? found - c : size;");
+                    emit(transpiler, "if(i >= size) c = grow(c, &size, i);");
+                    --transpiler->depth;
+                    emit(transpiler, "}");
+                } else if(operation->count > 0) {
+                    emit(transpiler, "while(c[i]) {");
+                    ++transpiler->depth;
+                    emit(transpiler, "i += %d;", operation->count);
+                    emit(transpiler, "if(i >= size) c = grow(c, &size, i);");
+                    --transpiler->depth;
+                    emit(transpiler, "}");
+                } else {
+                    emit(transpiler, "while(c[i] && i >= %d) i -= %d;", -operation->count, -operation->count);
+                }
+                emitGrowth(transpiler, index + 1);
+                break;
+            }
+            case OP_RANGE: {
+                // Only the original loop is transpiled, which the C compiler optimizes just as well. The copy
+                // without its moves follows it.
+                copy = operation->jump + 1;
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+
+    fputs(epilogue, output);
+    return ferror(output) == 0;
+}
@@ -0,0 +1,65 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// This header has no include guard on purpose. It holds the 8 variants of the threaded interpreter for one width,
+// one for every combination of whether it's safe, profiled and paged, and threaded.c includes it once for every
+// width. Before including it, THREADED_CELL_BITS must be defined, as for threaded.h.
+
+#define THREADED_SAFE 0
+#define THREADED_PROFILE 0
+#define THREADED_PAGED 0
+#include "threaded.h"
+
+#define THREADED_SAFE 1
+#define THREADED_PROFILE 0
+#define THREADED_PAGED 0
+#include "threaded.h"
+
+#define THREADED_SAFE 0
+#define THREADED_PROFILE 1
+#define THREADED_PAGED 0
+#include "threaded.h"
+
+#define THREADED_SAFE 1
+#define THREADED_PROFILE 1
+#define THREADED_PAGED 0
+#include "threaded.h"
+
+#define THREADED_SAFE 0
+#define THREADED_PROFILE 0
+#define THREADED_PAGED 1
+#include "threaded.h"
+
+#define THREADED_SAFE 1
+#define THREADED_PROFILE 0
+#define THREADED_PAGED 1
+#include "threaded.h"
+
+#define THREADED_SAFE 0
+#define THREADED_PROFILE 1
+#define THREADED_PAGED 1
+#include "threaded.h"
+
+#define THREADED_SAFE 1
+#define THREADED_PROFILE 1
+#define THREADED_PAGED 1
+#include "threaded.h"
@@ -0,0 +1,356 @@
+/**
+ * NIB (https://github.com/UnexomWid/nib)
+ *
+ * This project is licensed under the MIT license.
+ * Copyright (c) 2019 UnexomWid (https://uw.exom.dev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Needed for sigsetjmp() when compiling in strict C11 mode.
+#define _DEFAULT_SOURCE
+
+#include "nib.h"
+
+#include <setjmp.h>
+
+// Errors found by the guard pages leave the run from a signal handler, which must also restore the signal mask.
+#if defined(__unix__) || defined(__APPLE__)
+#define RECOVERY_BUFFER sigjmp_buf
+#define SET_RECOVERY(buffer) sigsetjmp(buffer, 1)
+#define RECOVER(buffer) siglongjmp(buffer, 1)
+#else
+#define RECOVERY_BUFFER jmp_buf
+#define SET_RECOVERY(buffer) setjmp(buffer)
+#define RECOVER(buffer) longjmp(buffer, 1)
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <windows.h>
+#define SET_CANCELLED(vm, value) InterlockedExchange(&(vm)->cancelled, value)
+#define IS_CANCELLED(vm) (InterlockedCompareExchange(&(vm)->cancelled, 0, 0) != 0)
+#else
+#define SET_CANCELLED(vm, value) atomic_store_explicit(&(vm)->cancelled, value, memory_order_relaxed)
+#define IS_CANCELLED(vm) atomic_load_explicit(&(vm)->cancelled, memory_order_relaxed)
+#endif
+
+// The amount of steps that runs take between checking their time limit and whether they were cancelled, unless the
+// largest loop takes more. This is a few milliseconds, even with the JIT.
+#define SLICE_STEPS ((uint64_t) 1 << 22)
+
+#define MEM_STEP_SIZE 32768u
+#define SAFE false
+#define ENGINE NIB_ENGINE_CLASSIC
+#define PACKED false
+#define BUFFER_SIZE 65536u
+#define LINE_BUFFERED false
+#define PROFILE false
+#define PAGED false
+#define MAX_MEMORY 0
+#define RESERVED_MEMORY ((uint64_t) 1 << 31)
+#define TIME_LIMIT 0
+#define CELL_BITS 8
+#define PRECOMPUTE_STEPS 0
+#define LOAD_THREADS 1
+
+NIB_THREAD_LOCAL nib_vm* runningVm = NULL;
+
+void nibDefaultOptions(struct NibOptions* options) {
+    options->memStepSize = MEM_STEP_SIZE;
+    options->safe = SAFE;
+    options->engine = ENGINE;
+    options->packed = PACKED;
+    options->bufferSize = BUFFER_SIZE;
+    options->lineBuffered = LINE_BUFFERED;
+    options->profile = PROFILE;
+    options->paged = PAGED;
+    options->maxMemory = MAX_MEMORY;
+    options->reservedMemory = RESERVED_MEMORY;
+    options->timeLimit = TIME_LIMIT;
+    options->cellBits = CELL_BITS;
+    options->precomputeSteps = PRECOMPUTE_STEPS;
+    options->loadThreads = LOAD_THREADS;
+}
+
+nib_vm* nibCreate(const struct NibOptions* options, const struct NibIo* io) {
+    if(options->cellBits != 8 && options->cellBits != 16 && options->cellBits != 32)
+        return NULL;
+
+    nib_vm* vm = (nib_vm*) calloc(1, sizeof(nib_vm));
+    if(vm == NULL)
+        return NULL;
+
+    vm->options = *options;
+    vm->io = io != NULL ? *io : standardIo;
+    vm->status = NIB_ERROR_NO_SCRIPT;
+    SET_CANCELLED(vm, false);
+
+    if(!setupTape(&vm->tape, options) || !setupBuffers(vm)) {
+        nibDestroy(vm);
+        return NULL;
+    }
+    return vm;
+}
+
+void prepareLoad(nib_vm* vm) {
+    // The native code, the profile, the snapshot and the mapped cache file belong to the previous program.
+    freeJit(vm);
+    freeProfile(vm);
+    freeSnapshot(vm);
+    freeCache(vm);
+
+    vm->programSize = 0;
+    vm->idioms.clearLoops = 0;
+    vm->idioms.multiplyLoops = 0;
+    vm->idioms.scanLoops = 0;
+    vm->idioms.balancedLoops = 0;
+    vm->errorIndex = 0;
+}
+
+void measureLoops(nib_vm* vm) {
+    vm->loopSteps = 0;
+    for(uint32_t i = 0; i < vm->programSize; ++i) {
+        const struct Operation* operation = vm->program + i;
+        if(operation->type == OP_LOOP_END && (uint32_t) operation->count > vm->loopSteps)
+            vm->loopSteps = (uint32_t) operation->count;
+    }
+}
+
+enum NIB_STATUS finishLoad(nib_vm* vm, enum NIB_STATUS status) {
+    vm->loopSteps = 0;
+    if(status == NIB_OK)
+        measureLoops(vm);
+
+    if(status == NIB_OK && vm->options.profile && !setupProfile(vm)) {
+        freeSnapshot(vm);
+        freeCache(vm);
+        freeAll(OPERATION, 1, &vm->program);
+        status = NIB_ERROR_MEMORY;
+    }
+
+    // The snapshot may have been mapped from the cache file already. The profiler counts every step, so it never
+    // starts from a snapshot.
+    if(status == NIB_OK && vm->options.precomputeSteps != 0 && !vm->options.profile && vm->snapshot == NULL)
+        precompute(vm);
+
+    nibReset(vm);
+    if(status != NIB_OK)
+        vm->status = status;
+    return status;
+}
+
+enum NIB_STATUS nibLoad(nib_vm* vm, const uint8_t* source, const size_t size) {
+    prepareLoad(vm);
+
+    // The decoded script is twice as large.
+    enum NIB_STATUS status;
+
+    if(size > SIZE_MAX / 2) {
+        freeAll(OPERATION, 1, &vm->program);
+        status = NIB_ERROR_TOO_LARGE;
+    } else if(vm->options.loadThreads > 1 && size >= 2 * NIB_CHUNK_SIZE) {
+        status = compileParallel(source, size, vm->options.packed, vm->options.loadThreads, &vm->program, &vm->programSize, &vm->idioms, &vm->errorIndex);
+    } else if(vm->options.packed) {
+        // Compile straight from the packed nibbles, without decoding them to a buffer that is twice as large.
+        status = compilePacked(source, size, &vm->program, &vm->programSize, &vm->idioms, &vm->errorIndex);
+    } else {
+        uint8_t* decoded = NULL;
+        const size_t decodedSize = decode(source, size, &decoded);
+
+        if(decoded != NULL) {
+            status = compile(decoded, decodedSize, &vm->program, &vm->programSize, &vm->idioms, &vm->errorIndex);
+            free(decoded);
+        } else {
+            freeAll(OPERATION, 1, &vm->program);
+            status = NIB_ERROR_MEMORY;
+        }
+    }
+
+    return finishLoad(vm, status);
+}
+
+/**
+ * Runs the program of a virtual machine with the engine from its options.
+ *
+ * @param[in, out] vm The running virtual machine.
+ */
+static void runEngine(nib_vm* vm) {
+    const bool safe = vm->options.safe;
+    const enum NIB_ENGINE engine = vm->options.engine;
+
+    // Interpret, either normally or safely.
+    // Both interpreters could be merged into one, as they only differ in a few lines of code.
+    // However, it would be slower because the value of "safe" would need to be checked for every operation.
+    // Also, merging them would make it harder for the safe interpreter to be changed in the future.
+    // There is also the option of merging them and checking the value of "safe" at the beginning, basically splitting the function body.
+    // The JIT is not available everywhere, in which case the threaded interpreter is used instead.
+    // The profiler has its own variants of the threaded interpreter, so that the others don't count anything. The
+    // paged data array has its own variants as well, so that the others don't look for pages. Wider values have
+    // variants for all of these, which are picked by their width.
+    if(vm->tape.cellSize != 1) {
+        interpretThreadedWide(vm);
+    } else if(vm->tape.pages != NULL) {
+        if(vm->profile != NULL) {
+            if(safe)
+                interpretThreadedSafelyPagedProfiled(vm);
+            else interpretThreadedPagedProfiled(vm);
+        } else if(safe) {
+            interpretThreadedSafelyPaged(vm);
+        } else interpretThreadedPaged(vm);
+    } else if(vm->profile != NULL) {
+        if(safe)
+            interpretThreadedSafelyProfiled(vm);
+        else interpretThreadedProfiled(vm);
+    } else if(engine == NIB_ENGINE_JIT && interpretJit(vm)) {
+        // Already run.
+    } else if(engine == NIB_ENGINE_THREADED || engine == NIB_ENGINE_JIT) {
+        if(safe)
+            interpretThreadedSafely(vm);
+        else interpretThreaded(vm);
+    } else {
+        if(safe)
+            interpretSafely(vm);
+        else interpret(vm);
+    }
+}
+
+enum NIB_STATUS runProgram(nib_vm* vm, const uint64_t steps, const double deadline) {
+    const uint64_t sliceSteps = SLICE_STEPS < vm->loopSteps ? vm->loopSteps : SLICE_STEPS;
+    const bool timed = vm->options.timeLimit != 0;
+
+    // Runs can be nested, if the I/O of a virtual machine runs another one.
+    nib_vm* previousVm = runningVm;
+    RECOVERY_BUFFER recovery;
+    void* previousRecovery = vm->recovery;
+    vm->recovery = &recovery;
+    // Volatile, as they change after the recovery point.
+    volatile uint64_t stepsLeft = steps;
+    volatile enum NIB_STATUS stopStatus = NIB_STEP_LIMIT;
+
+    if(SET_RECOVERY(recovery) == 0) {
+        runningVm = vm;
+
+        // The precomputed output comes first.
+        if(vm->snapshotPending) {
+            vm->snapshotPending = false;
+            if(vm->snapshot->outputSize != 0 && !vm->io.write(vm->io.context, vm->snapshot->output, vm->snapshot->outputSize))
+                raiseError(vm, NIB_ERROR_OUTPUT, 0);
+        }
+
+        // The engines stop at a loop end once the slice runs out, and resume from it, so slicing the steps doesn't
+        // change where the run stops. The last slice is cut short by the maximum amount of steps, and there are no
+        // slices if the whole program was precomputed.
+        while(vm->programIndex != vm->programSize) {
+            if(IS_CANCELLED(vm)) {
+                SET_CANCELLED(vm, false);
+                stopStatus = NIB_CANCELLED;
+                break;
+            }
+
+            const bool lastSlice = stepsLeft <= sliceSteps;
+            const uint64_t slice = lastSlice ? stepsLeft : sliceSteps;
+            vm->steps = slice;
+            runEngine(vm);
+            stepsLeft -= slice - vm->steps;
+
+            if(lastSlice || vm->programIndex == vm->programSize)
+                break;
+            if(timed && profileClock() >= deadline) {
+                stopStatus = NIB_TIMEOUT;
+                break;
+            }
+        }
+
+        if(!flushOutput(vm))
+            raiseError(vm, NIB_ERROR_OUTPUT, 0);
+    } else {
+        // Show whatever the script wrote before failing.
+        flushOutput(vm);
+    }
+
+    runningVm = previousVm;
+    vm->recovery = previousRecovery;
+    vm->steps = stepsLeft;
+
+    if(vm->profile != NULL)
+        vm->profile->steps += steps - stepsLeft;
+
+    if(vm->status != NIB_OK)
+        return vm->status;
+    if(vm->programIndex == vm->programSize)
+        return NIB_OK;
+
+    // Report the loop end that the run stopped at.
+    vm->errorIndex = (vm->program + vm->programIndex)->inputIndex;
+    return stopStatus;
+}
+
+enum NIB_STATUS nibRun(nib_vm* vm, const uint64_t maxSteps) {
+    // The precomputed output is still written if the whole program was precomputed.
+    if(vm->status != NIB_OK || (vm->programIndex == vm->programSize && !vm->snapshotPending))
+        return vm->status;
+
+    const uint64_t steps = maxSteps == 0 ? UINT64_MAX : maxSteps < vm->loopSteps ? vm->loopSteps : maxSteps;
+    const double deadline = vm->options.timeLimit != 0 ? profileClock() + vm->options.timeLimit / 1000.0 : 0;
+    return runProgram(vm, steps, deadline);
+}
+
+void raiseError(nib_vm* vm, const enum NIB_STATUS status, const uint64_t inputIndex) {
+    // The data array can't tell why it could not grow, so it remembers if it was because of its limit.
+    vm->status = status == NIB_ERROR_MEMORY && vm->tape.limitReached ? NIB_ERROR_MEMORY_LIMIT : status;
+    vm->errorIndex = inputIndex;
+
+    RECOVER(*(RECOVERY_BUFFER*) vm->recovery);
+}
+
+void nibReset(nib_vm* vm) {
+    vm->programIndex = 0;
+    vm->dataIndex = 0;
+    vm->status = vm->program != NULL ? NIB_OK : NIB_ERROR_NO_SCRIPT;
+    vm->snapshotPending = false;
+    SET_CANCELLED(vm, false);
+
+    resetBuffers(vm);
+    resetProfile(vm);
+    if(!resetTape(&vm->tape) || !restoreSnapshot(vm))
+        vm->status = NIB_ERROR_MEMORY;
+}
+
+void nibDestroy(nib_vm* vm) {
+    if(vm == NULL)
+        return;
+
+    freeJit(vm);
+    freeProfile(vm);
+    freeSnapshot(vm);
+    freeCache(vm);
+    freeBuffers(vm);
+    freeTape(&vm->tape);
+    freeAll(OPERATION, 1, &vm->program);
+    free(vm);
+}
+
+void nibCancel(nib_vm* vm) {
+    SET_CANCELLED(vm, true);
+}
+
+uint64_t nibErrorIndex(const nib_vm* vm) {
+    return vm->errorIndex;
+}
+
+const struct IdiomStatistics* nibStatistics(const nib_vm* vm) {
+    return &vm->idioms;
+}